@@ -0,0 +1,99 @@
+#include "MeshWriter.h"
+
+#include "Assets/MeshFormat.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+template<typename T>
+static void Append(std::vector<uint8_t>& file, const T* values, size_t count)
+{
+	const uint8_t* bytes = (const uint8_t*)values;
+	file.insert(file.end(), bytes, bytes + sizeof(T) * count);
+}
+
+static void ExpandBounds(const ImportedVertex& vertex, float* boundsMin, float* boundsMax)
+{
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		boundsMin[axis] = std::min(boundsMin[axis], vertex.Position[axis]);
+		boundsMax[axis] = std::max(boundsMax[axis], vertex.Position[axis]);
+	}
+}
+
+bool MeshWriter::Write(const std::filesystem::path& filepath, const ImportedMesh& mesh)
+{
+	MeshFileHeader header{};
+	header.Magic = MeshFileMagic;
+	header.Version = MeshFileVersion;
+	header.VertexStride = sizeof(ImportedVertex);
+	header.AttributeCount = 3;
+	header.VertexCount = (uint32_t)mesh.Vertices.size();
+	header.IndexType = MeshIndexType::Uint32; // The geometry pool only holds 32 bit indices
+	header.IndexCount = (uint32_t)mesh.Indices.size();
+	header.SubmeshCount = (uint32_t)mesh.Submeshes.size();
+
+	MeshVertexAttribute attributes[] = {
+		{ MeshAttributeSemantic::Position, MeshAttributeFormat::Float3, (uint32_t)offsetof(ImportedVertex, Position) },
+		{ MeshAttributeSemantic::Color, MeshAttributeFormat::Float3, (uint32_t)offsetof(ImportedVertex, Color) },
+		{ MeshAttributeSemantic::TextureCoord, MeshAttributeFormat::Float2, (uint32_t)offsetof(ImportedVertex, TextureCoord) }
+	};
+
+	std::fill(header.BoundsMin, header.BoundsMin + 3, FLT_MAX);
+	std::fill(header.BoundsMax, header.BoundsMax + 3, -FLT_MAX);
+
+	std::vector<MeshSubmesh> submeshes;
+	for (const auto& imported : mesh.Submeshes)
+	{
+		MeshSubmesh submesh{};
+		submesh.FirstIndex = imported.FirstIndex;
+		submesh.IndexCount = imported.IndexCount;
+		std::fill(submesh.BoundsMin, submesh.BoundsMin + 3, FLT_MAX);
+		std::fill(submesh.BoundsMax, submesh.BoundsMax + 3, -FLT_MAX);
+
+		for (uint32_t i = 0; i < imported.IndexCount; i++)
+			ExpandBounds(mesh.Vertices[mesh.Indices[imported.FirstIndex + i]], submesh.BoundsMin, submesh.BoundsMax);
+
+		submeshes.push_back(submesh);
+	}
+
+	for (const auto& vertex : mesh.Vertices)
+		ExpandBounds(vertex, header.BoundsMin, header.BoundsMax);
+
+	uint64_t tableEnd = sizeof(MeshFileHeader) + sizeof(attributes) + sizeof(MeshSubmesh) * submeshes.size();
+	header.VertexDataOffset = AlignUp(tableEnd, MeshFileDataAlignment);
+	header.IndexDataOffset = AlignUp(header.VertexDataOffset + sizeof(ImportedVertex) * mesh.Vertices.size(), MeshFileDataAlignment);
+
+	std::vector<uint8_t> file;
+	file.reserve(header.IndexDataOffset + sizeof(uint32_t) * mesh.Indices.size());
+	file.resize(sizeof(MeshFileHeader));
+
+	Append(file, attributes, 3);
+	Append(file, submeshes.data(), submeshes.size());
+	file.resize(header.VertexDataOffset);
+	Append(file, mesh.Vertices.data(), mesh.Vertices.size());
+	file.resize(header.IndexDataOffset);
+	Append(file, mesh.Indices.data(), mesh.Indices.size());
+
+	// FNV-1a, the header goes in last as it carries the result
+	header.ContentHash = 14695981039346656037ull;
+	for (size_t i = sizeof(MeshFileHeader); i < file.size(); i++)
+		header.ContentHash = (header.ContentHash ^ file[i]) * 1099511628211ull;
+
+	memcpy(file.data(), &header, sizeof(header));
+
+	std::ofstream stream(filepath, std::ios::binary);
+	if (!stream)
+		return false;
+
+	stream.write((const char*)file.data(), file.size());
+	return stream.good();
+}
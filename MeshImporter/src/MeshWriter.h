@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ObjParser.h"
+
+// Writes a .vmesh file (see Assets/MeshFormat.h in the sandbox), with the bounds of the mesh and of every submesh
+// and the content hash the asset cache keys on
+class MeshWriter
+{
+public:
+	static bool Write(const std::filesystem::path& filepath, const ImportedMesh& mesh);
+};
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+	struct VertexKey
+	{
+		int32_t Position;
+		int32_t TextureCoord;
+
+		bool operator==(const VertexKey& other) const { return Position == other.Position && TextureCoord == other.TextureCoord; }
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const { return std::hash<uint64_t>()((uint64_t)(uint32_t)key.Position << 32 | (uint32_t)key.TextureCoord); }
+	};
+}
+
+// OBJ indices start at 1, negative ones count back from the last element read so far
+static bool ResolveIndex(int32_t index, size_t count, int32_t& resolved)
+{
+	if (index > 0)
+		resolved = index - 1;
+	else if (index < 0)
+		resolved = (int32_t)count + index;
+	else
+		return false;
+
+	return resolved >= 0 && (size_t)resolved < count;
+}
+
+bool ObjParser::Parse(const std::filesystem::path& filepath, ImportedMesh& mesh, std::string& error)
+{
+	std::ifstream file(filepath);
+	if (!file)
+	{
+		error = "Failed to open " + filepath.string();
+		return false;
+	}
+
+	std::vector<std::array<float, 6>> positions;
+	std::vector<std::array<float, 2>> textureCoords;
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexMap;
+	std::vector<uint32_t> polygon;
+
+	mesh.Submeshes.push_back({ filepath.stem().string() });
+
+	std::string line;
+	uint32_t lineNumber = 0;
+
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v")
+		{
+			std::array<float, 6> position = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+			stream >> position[0] >> position[1] >> position[2];
+
+			if (!stream)
+			{
+				error = "Invalid position on line " + std::to_string(lineNumber);
+				return false;
+			}
+
+			// Colors are an unofficial extension, the vertex stays white without them
+			float color[3];
+			if (stream >> color[0] >> color[1] >> color[2])
+				std::copy(color, color + 3, position.begin() + 3);
+
+			positions.push_back(position);
+		} else if (keyword == "vt")
+		{
+			std::array<float, 2> textureCoord = { 0.0f, 0.0f };
+			stream >> textureCoord[0] >> textureCoord[1];
+
+			// OBJ puts v = 0 at the bottom of the image, Vulkan samples it at the top
+			textureCoord[1] = 1.0f - textureCoord[1];
+			textureCoords.push_back(textureCoord);
+		} else if (keyword == "o" || keyword == "g" || keyword == "usemtl")
+		{
+			std::string name;
+			std::getline(stream >> std::ws, name);
+
+			ImportedSubmesh& current = mesh.Submeshes.back();
+			if (current.IndexCount > 0)
+				mesh.Submeshes.push_back({ name, (uint32_t)mesh.Indices.size() });
+			else if (!name.empty())
+				current.Name = name;
+		} else if (keyword == "f")
+		{
+			polygon.clear();
+
+			std::string corner;
+			while (stream >> corner)
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				int32_t positionIndex = 0;
+				int32_t textureCoordIndex = 0;
+				size_t slash = corner.find('/');
+
+				try
+				{
+					positionIndex = std::stoi(corner.substr(0, slash));
+					if (slash != std::string::npos && slash + 1 < corner.size() && corner[slash + 1] != '/')
+						textureCoordIndex = std::stoi(corner.substr(slash + 1));
+				} catch (const std::exception&)
+				{
+					error = "Invalid face on line " + std::to_string(lineNumber);
+					return false;
+				}
+
+				VertexKey key{};
+				key.TextureCoord = -1;
+
+				if (!ResolveIndex(positionIndex, positions.size(), key.Position)
+					|| (textureCoordIndex != 0 && !ResolveIndex(textureCoordIndex, textureCoords.size(), key.TextureCoord)))
+				{
+					error = "Face index out of range on line " + std::to_string(lineNumber);
+					return false;
+				}
+
+				auto [it, inserted] = vertexMap.try_emplace(key, (uint32_t)mesh.Vertices.size());
+				if (inserted)
+				{
+					const auto& position = positions[key.Position];
+
+					ImportedVertex vertex{};
+					std::copy(position.begin(), position.begin() + 3, vertex.Position);
+					std::copy(position.begin() + 3, position.end(), vertex.Color);
+					if (key.TextureCoord >= 0)
+						std::copy(textureCoords[key.TextureCoord].begin(), textureCoords[key.TextureCoord].end(), vertex.TextureCoord);
+
+					mesh.Vertices.push_back(vertex);
+				}
+
+				polygon.push_back(it->second);
+			}
+
+			if (polygon.size() < 3)
+			{
+				error = "Face with less than 3 corners on line " + std::to_string(lineNumber);
+				return false;
+			}
+
+			for (size_t i = 1; i + 1 < polygon.size(); i++)
+			{
+				mesh.Indices.push_back(polygon[0]);
+				mesh.Indices.push_back(polygon[i]);
+				mesh.Indices.push_back(polygon[i + 1]);
+			}
+
+			mesh.Submeshes.back().IndexCount += (uint32_t)(polygon.size() - 2) * 3;
+		}
+	}
+
+	// Groups without faces don't make it into the file
+	mesh.Submeshes.erase(std::remove_if(mesh.Submeshes.begin(), mesh.Submeshes.end(), [](const ImportedSubmesh& submesh) { return submesh.IndexCount == 0; }), mesh.Submeshes.end());
+
+	if (mesh.Indices.empty())
+	{
+		error = filepath.string() + " has no faces";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Same layout as the sandbox Vertex, which the .vmesh attribute table describes
+struct ImportedVertex
+{
+	float Position[3];
+	float Color[3];
+	float TextureCoord[2];
+};
+
+struct ImportedSubmesh
+{
+	std::string Name;
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+};
+
+struct ImportedMesh
+{
+	std::vector<ImportedVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<ImportedSubmesh> Submeshes;
+};
+
+// Wavefront OBJ reader for positions, optional per vertex colors ("v x y z r g b") and texture coordinates.
+// Polygons are triangulated as fans, identical position/texture coordinate pairs share a vertex and every
+// o/g/usemtl statement starts a new submesh. Normals and materials are skipped, the sandbox doesn't use them.
+class ObjParser
+{
+public:
+	static bool Parse(const std::filesystem::path& filepath, ImportedMesh& mesh, std::string& error);
+};
\ No newline at end of file
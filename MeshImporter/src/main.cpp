@@ -0,0 +1,66 @@
+#include "MeshWriter.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Converts OBJ models into .vmesh files the sandbox maps and uploads without parsing. The default output sits
+// next to the input as <name>.vmesh.
+//
+// MeshImporter <input.obj> [--output <file>]
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: MeshImporter <input.obj> [--output <file>]" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path input = argv[1];
+	std::filesystem::path output;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+
+		if (arg == "--output" && i + 1 < argc)
+			output = argv[++i];
+	}
+
+	if (input.extension() != ".obj")
+	{
+		std::cout << "Only OBJ files are supported, " << input << std::endl;
+		return 1;
+	}
+
+	if (output.empty())
+	{
+		output = input;
+		output.replace_extension(".vmesh");
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	ImportedMesh mesh;
+	std::string error;
+
+	if (!ObjParser::Parse(input, mesh, error))
+	{
+		std::cout << error << std::endl;
+		return 1;
+	}
+
+	if (!MeshWriter::Write(output, mesh))
+	{
+		std::cout << "Failed to write " << output << std::endl;
+		return 1;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << input << " -> " << output << ": " << mesh.Vertices.size() << " vertices, " << mesh.Indices.size() / 3 << " triangles, "
+		<< mesh.Submeshes.size() << " submeshes in " << ms << " ms" << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include "Bc1Encoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+static uint16_t ToRgb565(const int32_t color[3])
+{
+	return (uint16_t)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+static void FromRgb565(uint16_t packed, int32_t color[3])
+{
+	int32_t r = (packed >> 11) & 31;
+	int32_t g = (packed >> 5) & 63;
+	int32_t b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+std::vector<uint8_t> Bc1Encoder::Encode(const uint8_t* pixels, uint32_t width, uint32_t height)
+{
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+
+	std::vector<uint8_t> output((size_t)blocksX * blocksY * 8);
+
+	// Rows of blocks are independent, split them over the cores
+	uint32_t threadCount = std::max(std::min(std::thread::hardware_concurrency(), blocksY), 1u);
+	std::vector<std::thread> threads;
+
+	for (uint32_t t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			uint8_t block[16][4];
+
+			for (uint32_t by = t; by < blocksY; by += threadCount)
+			{
+				for (uint32_t bx = 0; bx < blocksX; bx++)
+				{
+					// Blocks over the edge repeat the last row and column
+					for (uint32_t i = 0; i < 16; i++)
+					{
+						uint32_t x = std::min(bx * 4 + i % 4, width - 1);
+						uint32_t y = std::min(by * 4 + i / 4, height - 1);
+						memcpy(block[i], pixels + ((size_t)y * width + x) * 4, 4);
+					}
+
+					EncodeBlock(block, output.data() + ((size_t)by * blocksX + bx) * 8);
+				}
+			}
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	return output;
+}
+
+void Bc1Encoder::EncodeBlock(const uint8_t block[16][4], uint8_t* output)
+{
+	bool transparent = false;
+	int32_t min[3] = { 255, 255, 255 };
+	int32_t max[3] = { 0, 0, 0 };
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if (block[i][3] < 128)
+		{
+			transparent = true;
+			continue;
+		}
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			min[c] = std::min(min[c], (int32_t)block[i][c]);
+			max[c] = std::max(max[c], (int32_t)block[i][c]);
+		}
+	}
+
+	// Fully transparent, the 3 color mode with every index on transparent black
+	if (max[0] < min[0])
+	{
+		uint8_t empty[8] = { 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF };
+		memcpy(output, empty, 8);
+		return;
+	}
+
+	// Endpoints are the opaque pixels furthest apart along the diagonal of the color range
+	int32_t axis[3] = { max[0] - min[0], max[1] - min[1], max[2] - min[2] };
+	int32_t minProjection = INT32_MAX;
+	int32_t maxProjection = INT32_MIN;
+	int32_t endpoints[2][3] = {};
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		if (block[i][3] < 128)
+			continue;
+
+		int32_t projection = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+
+		if (projection < minProjection)
+		{
+			minProjection = projection;
+			for (uint32_t c = 0; c < 3; c++)
+				endpoints[1][c] = block[i][c];
+		}
+
+		if (projection > maxProjection)
+		{
+			maxProjection = projection;
+			for (uint32_t c = 0; c < 3; c++)
+				endpoints[0][c] = block[i][c];
+		}
+	}
+
+	uint16_t color0 = ToRgb565(endpoints[0]);
+	uint16_t color1 = ToRgb565(endpoints[1]);
+
+	// color0 > color1 selects 4 colors, color0 <= color1 selects 3 colors and transparent black
+	if (transparent ? color0 > color1 : color0 < color1)
+		std::swap(color0, color1);
+
+	int32_t palette[4][3];
+	FromRgb565(color0, palette[0]);
+	FromRgb565(color1, palette[1]);
+
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		} else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	uint32_t colorCount = color0 > color1 ? 4 : 3;
+	uint32_t indices = 0;
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		uint32_t best = 3;
+
+		if (block[i][3] >= 128)
+		{
+			int32_t bestDistance = INT32_MAX;
+
+			for (uint32_t p = 0; p < colorCount; p++)
+			{
+				int32_t dr = block[i][0] - palette[p][0];
+				int32_t dg = block[i][1] - palette[p][1];
+				int32_t db = block[i][2] - palette[p][2];
+				int32_t distance = dr * dr + dg * dg + db * db;
+
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+		}
+
+		indices |= best << (i * 2);
+	}
+
+	output[0] = (uint8_t)(color0 & 0xFF);
+	output[1] = (uint8_t)(color0 >> 8);
+	output[2] = (uint8_t)(color1 & 0xFF);
+	output[3] = (uint8_t)(color1 >> 8);
+	memcpy(output + 4, &indices, 4);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Encodes RGBA8 pixels into BC1 blocks, 8 bytes per 4x4 pixels. Endpoints are the extremes of the block
+// along its color range, blocks with pixels below half alpha use the 3 color mode with transparent black.
+class Bc1Encoder
+{
+public:
+	static std::vector<uint8_t> Encode(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+private:
+	static void EncodeBlock(const uint8_t block[16][4], uint8_t* output);
+};
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "Ktx2Writer.h"
+
+#include <cstring>
+#include <fstream>
+
+static const uint8_t s_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const char s_writer[] = "KTXwriter\0VulkanSandbox TextureConverter";
+
+// Khronos data format values, see the Khronos Data Format Specification
+static constexpr uint8_t s_modelRgbsda = 1;
+static constexpr uint8_t s_modelBc1a = 128;
+static constexpr uint8_t s_primariesBt709 = 1;
+static constexpr uint8_t s_transferSrgb = 2;
+static constexpr uint8_t s_channelAlpha = 15;
+static constexpr uint8_t s_channelBc1aAlpha = 1;
+static constexpr uint8_t s_qualifierLinear = 0x10;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+template<typename T>
+static void Append(std::vector<uint8_t>& file, const T& value)
+{
+	const uint8_t* bytes = (const uint8_t*)&value;
+	file.insert(file.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static void Store(std::vector<uint8_t>& file, size_t offset, const T& value)
+{
+	memcpy(file.data() + offset, &value, sizeof(T));
+}
+
+bool Ktx2Writer::Write(const std::filesystem::path& filepath, const TextureLevels& texture)
+{
+	bool compressed = texture.Format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	uint32_t levelCount = (uint32_t)texture.Levels.size();
+
+	std::vector<uint32_t> dfd = CreateDataFormatDescriptor(texture.Format);
+
+	// Header
+	std::vector<uint8_t> file(s_identifier, s_identifier + sizeof(s_identifier));
+	Append<uint32_t>(file, texture.Format);
+	Append<uint32_t>(file, 1); // typeSize, 1 for block compressed and 8 bit formats
+	Append<uint32_t>(file, texture.Width);
+	Append<uint32_t>(file, texture.Height);
+	Append<uint32_t>(file, 0); // pixelDepth
+	Append<uint32_t>(file, 0); // layerCount
+	Append<uint32_t>(file, 1); // faceCount
+	Append<uint32_t>(file, levelCount);
+	Append<uint32_t>(file, 0); // supercompressionScheme
+
+	// Index, filled in once the offsets are known
+	size_t indexOffset = file.size();
+	file.resize(file.size() + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + levelCount * 3 * sizeof(uint64_t));
+
+	uint32_t dfdOffset = (uint32_t)file.size();
+	for (uint32_t word : dfd)
+		Append(file, word);
+
+	uint32_t kvdOffset = (uint32_t)file.size();
+	Append<uint32_t>(file, sizeof(s_writer));
+	file.insert(file.end(), s_writer, s_writer + sizeof(s_writer));
+	file.resize(AlignUp(file.size(), 4));
+	uint32_t kvdLength = (uint32_t)file.size() - kvdOffset;
+
+	Store<uint32_t>(file, indexOffset, dfdOffset);
+	Store<uint32_t>(file, indexOffset + 4, (uint32_t)(dfd.size() * sizeof(uint32_t)));
+	Store<uint32_t>(file, indexOffset + 8, kvdOffset);
+	Store<uint32_t>(file, indexOffset + 12, kvdLength);
+	Store<uint64_t>(file, indexOffset + 16, 0); // sgdByteOffset
+	Store<uint64_t>(file, indexOffset + 24, 0); // sgdByteLength
+
+	// Levels go smallest first, each aligned to the texel block size and 4
+	uint64_t alignment = compressed ? 8 : 4;
+	size_t levelIndexOffset = indexOffset + 32;
+
+	for (int32_t mip = (int32_t)levelCount - 1; mip >= 0; mip--)
+	{
+		const auto& level = texture.Levels[mip];
+
+		file.resize(AlignUp(file.size(), alignment));
+
+		size_t entry = levelIndexOffset + mip * 3 * sizeof(uint64_t);
+		Store<uint64_t>(file, entry, file.size());
+		Store<uint64_t>(file, entry + 8, level.size());
+		Store<uint64_t>(file, entry + 16, level.size());
+
+		file.insert(file.end(), level.begin(), level.end());
+	}
+
+	std::ofstream stream(filepath, std::ios::binary);
+	stream.write((const char*)file.data(), file.size());
+
+	return (bool)stream;
+}
+
+std::vector<uint32_t> Ktx2Writer::CreateDataFormatDescriptor(VkFormat format)
+{
+	bool compressed = format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	uint32_t sampleCount = compressed ? 1 : 4;
+	uint32_t blockSize = 24 + 16 * sampleCount;
+
+	std::vector<uint32_t> dfd;
+	dfd.push_back(4 + blockSize); // dfdTotalSize
+	dfd.push_back(0); // vendorId and descriptorType, Khronos basic descriptor
+	dfd.push_back(2 | blockSize << 16); // versionNumber and descriptorBlockSize
+	dfd.push_back((compressed ? s_modelBc1a : s_modelRgbsda) | s_primariesBt709 << 8 | s_transferSrgb << 16); // flags 0, straight alpha
+	dfd.push_back(compressed ? 3 | 3 << 8 : 0); // texelBlockDimension, minus one
+	dfd.push_back(compressed ? 8 : 4); // bytesPlane0
+	dfd.push_back(0); // bytesPlane4 to 7
+
+	if (compressed)
+	{
+		// One 64 bit sample covering the whole block, color with punch-through alpha
+		dfd.push_back(0 | 63 << 16 | s_channelBc1aAlpha << 24);
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(0xFFFFFFFF);
+		return dfd;
+	}
+
+	// R, G and B are sRGB encoded, alpha is linear
+	for (uint32_t channel = 0; channel < 4; channel++)
+	{
+		uint32_t channelType = channel == 3 ? s_channelAlpha | s_qualifierLinear : channel;
+
+		dfd.push_back(channel * 8 | 7 << 16 | channelType << 24);
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(255);
+	}
+
+	return dfd;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+#include <vector>
+
+struct TextureLevels
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	VkFormat Format = VK_FORMAT_UNDEFINED; // VK_FORMAT_R8G8B8A8_SRGB or VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+	std::vector<std::vector<uint8_t>> Levels; // Level 0 first
+};
+
+// Writes a KTX2 file (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) without supercompression,
+// with the data format descriptor the spec requires and levels stored smallest first
+class Ktx2Writer
+{
+public:
+	static bool Write(const std::filesystem::path& filepath, const TextureLevels& texture);
+
+private:
+	static std::vector<uint32_t> CreateDataFormatDescriptor(VkFormat format);
+};
\ No newline at end of file
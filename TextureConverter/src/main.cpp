@@ -0,0 +1,177 @@
+#include "Bc1Encoder.h"
+#include "Ktx2Writer.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Converts JPEG/PNG source textures into KTX2 files with a full mip chain, so the sandbox uploads them as they
+// are instead of decoding at runtime. The default output sits next to the input as <name>.bc1.ktx2, where
+// Texture looks for compressed variants.
+//
+// TextureConverter <input> [--output <file>] [--format bc1|rgba8] [--no-mips]
+
+// Both output formats are sRGB, which the GPU filters on linear values. Averaging the encoded bytes instead
+// darkens every level.
+static float SrgbToLinear(uint8_t value)
+{
+	static const std::array<float, 256> s_table = []()
+	{
+		std::array<float, 256> table;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return table;
+	}();
+
+	return s_table[value];
+}
+
+static uint8_t LinearToSrgb(float value)
+{
+	float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
+static std::vector<uint8_t> Downsample(const std::vector<uint8_t>& src, uint32_t srcWidth, uint32_t srcHeight, uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> dst((size_t)width * height * 4);
+
+	// 2x2 box filter, the last row or column of odd sized levels is clamped
+	for (uint32_t y = 0; y < height; y++)
+	{
+		uint32_t y0 = std::min(y * 2, srcHeight - 1);
+		uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+		for (uint32_t x = 0; x < width; x++)
+		{
+			uint32_t x0 = std::min(x * 2, srcWidth - 1);
+			uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+			const uint8_t* texels[4] = { &src[((size_t)y0 * srcWidth + x0) * 4], &src[((size_t)y0 * srcWidth + x1) * 4],
+				&src[((size_t)y1 * srcWidth + x0) * 4], &src[((size_t)y1 * srcWidth + x1) * 4] };
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				float sum = SrgbToLinear(texels[0][c]) + SrgbToLinear(texels[1][c]) + SrgbToLinear(texels[2][c]) + SrgbToLinear(texels[3][c]);
+				dst[((size_t)y * width + x) * 4 + c] = LinearToSrgb(sum * 0.25f);
+			}
+
+			// Alpha is stored linear
+			uint32_t alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+			dst[((size_t)y * width + x) * 4 + 3] = (uint8_t)((alpha + 2) / 4);
+		}
+	}
+
+	return dst;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: TextureConverter <input> [--output <file>] [--format bc1|rgba8] [--no-mips]" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::path input = argv[1];
+	std::filesystem::path output;
+	VkFormat format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+	bool mips = true;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+
+		if (arg == "--output" && i + 1 < argc)
+			output = argv[++i];
+
+		if (arg == "--format" && i + 1 < argc)
+		{
+			std::string_view name = argv[++i];
+
+			if (name == "bc1")
+				format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+			else if (name == "rgba8")
+				format = VK_FORMAT_R8G8B8A8_SRGB;
+			else
+				std::cout << "Unknown format " << name << ", use bc1 or rgba8" << std::endl;
+		}
+
+		if (arg == "--no-mips")
+			mips = false;
+	}
+
+	if (output.empty())
+	{
+		output = input;
+		output.replace_extension(format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ? ".bc1.ktx2" : ".rgba8.ktx2");
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(input.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+	if (!pixels)
+	{
+		std::cout << "Failed to load " << input << std::endl;
+		return 1;
+	}
+
+	std::vector<uint8_t> level(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	TextureLevels texture;
+	texture.Width = width;
+	texture.Height = height;
+	texture.Format = format;
+
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	size_t sourceBytes = 0;
+
+	while (true)
+	{
+		sourceBytes += level.size();
+
+		if (format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK)
+			texture.Levels.push_back(Bc1Encoder::Encode(level.data(), levelWidth, levelHeight));
+		else
+			texture.Levels.push_back(level);
+
+		if (!mips || (levelWidth == 1 && levelHeight == 1))
+			break;
+
+		uint32_t nextWidth = std::max(levelWidth / 2, 1u);
+		uint32_t nextHeight = std::max(levelHeight / 2, 1u);
+		level = Downsample(level, levelWidth, levelHeight, nextWidth, nextHeight);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	if (!Ktx2Writer::Write(output, texture))
+	{
+		std::cout << "Failed to write " << output << std::endl;
+		return 1;
+	}
+
+	size_t outputBytes = 0;
+	for (const auto& encoded : texture.Levels)
+		outputBytes += encoded.size();
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << input << " -> " << output << ": " << width << "x" << height << ", " << texture.Levels.size() << " levels, "
+		<< sourceBytes / 1024 << " KB -> " << outputBytes / 1024 << " KB in " << ms << " ms" << std::endl;
+
+	return 0;
+}
@@ -1,10 +1,23 @@
 #include "Application.h"
 
+#include "Jobs/JobSystem.h"
 #include "Memory/Allocator.h"
+#include "Memory/DeletionCommandQueue.h"
+#include "Profiling/Profiler.h"
 #include "Vertex.h"
 
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <set>
 #include <sstream>
+#include <thread>
 
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
 {
@@ -67,22 +80,45 @@ const std::vector<uint32_t> indices{
 	4, 5, 6, 6, 7, 4
 };
 
-Application::Application()
+Application::Application(const ApplicationSpecification& specification)
+	: m_specification(specification)
 {
 	s_instance = this;
 
 	LOG("Starting VulkanSandbox");
 
-	int status = glfwInit();
-	if (status != GLFW_TRUE)
-		LOG("glfwInit() failed!");
+	// Everything sized per frame in flight reads this, so it has to be set before any of it is created
+	if (m_specification.FramesInFlight < 1 || m_specification.FramesInFlight > VulkanConfig::MaxFramesInFlightLimit)
+		throw std::runtime_error("Frames in flight has to be between 1 and VulkanConfig::MaxFramesInFlightLimit!");
+	VulkanConfig::MaxFramesInFlight = m_specification.FramesInFlight;
+	VulkanConfig::GenerateMipmaps = m_specification.Mipmaps;
+
+	if (m_specification.ObjectCount < 1 || m_specification.TextureCount < 1)
+		throw std::runtime_error("The scene needs at least one object and one texture!");
+
+	if (m_specification.FrameCount == 0 && m_specification.Benchmark)
+		m_specification.FrameCount = 1000;
+	else if (m_specification.FrameCount == 0 && m_specification.Headless)
+		m_specification.FrameCount = 600;
+
+	if (m_specification.Benchmark && m_specification.FrameCount <= VulkanConfig::BenchmarkWarmupFrames)
+		throw std::runtime_error("A benchmark needs more frames than VulkanConfig::BenchmarkWarmupFrames!");
+
+	JobSystem::Init(VulkanConfig::JobThreadCount);
+
+	if (!m_specification.Headless)
+	{
+		int status = glfwInit();
+		if (status != GLFW_TRUE)
+			LOG("glfwInit() failed!");
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
-	m_window = glfwCreateWindow(VulkanConfig::Width, VulkanConfig::Height, "VulkanSandbox", nullptr, nullptr);
+		m_window = glfwCreateWindow(VulkanConfig::Width, VulkanConfig::Height, "VulkanSandbox", nullptr, nullptr);
 
-	// FRAMEBUFFER RESIZE CALLBACK HERE
+		// FRAMEBUFFER RESIZE CALLBACK HERE
+	}
 
 	if (VulkanConfig::EnableValidation && !HasValidationLayerSupport())
 		throw std::runtime_error("Validation layers requested but not available!");
@@ -128,24 +164,65 @@ Application::Application()
 		VK_CHECK(CreateDebugUtilsMessengerEXT(m_instance, &debugCreateInfo, nullptr, &m_debugMessenger), "Failed to create debug messenger!");
 
 	m_physicalDevice = std::make_shared<PhysicalDevice>();
-	m_logicalDevice = std::make_shared<LogicalDevice>(m_physicalDevice);
+	m_logicalDevice = std::make_shared<LogicalDevice>(m_physicalDevice, !m_specification.Headless);
 
 	Allocator::Init();
+	m_gpuProfiler = std::make_shared<GpuProfiler>(m_logicalDevice);
+	m_uploadContext = std::make_shared<UploadContext>(m_logicalDevice);
+	m_assetManager = std::make_shared<AssetManager>();
+
+	if (m_specification.Headless)
+	{
+		HeadlessTarget::ReadbackFn readbackFn;
+		if (!m_specification.ReadbackPath.empty())
+			readbackFn = [this](const ReadbackFrame& frame) { WriteReadback(frame); };
 
-	m_swapchain = std::make_shared<Swapchain>(m_logicalDevice);
+		m_renderTarget = std::make_shared<HeadlessTarget>(m_logicalDevice, VulkanConfig::Width, VulkanConfig::Height, readbackFn);
+	} else
+	{
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(m_window, &width, &height);
+
+		m_renderTarget = std::make_shared<Swapchain>(m_logicalDevice, (uint32_t)width, (uint32_t)height, m_specification.PresentMode);
+	}
+	m_frameLimit = m_specification.FrameLimit;
 	m_pipeline = std::make_shared<Pipeline>(m_logicalDevice);
 	
 	// Buffers
-	uint32_t vertexBufferSize = sizeof(Vertex) * vertices.size();
-	m_vertexBuffer = std::make_shared<VertexBuffer>((void*)vertices.data(), vertexBufferSize);
+	m_geometryPool = std::make_shared<GeometryPool>(m_logicalDevice);
+	if (m_specification.MeshPath.empty())
+	{
+		m_mesh = m_assetManager->LoadMesh("Quad", vertices.data(), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size());
+	} else
+	{
+		m_mesh = m_assetManager->LoadMesh(m_specification.MeshPath);
 
-	uint32_t indexBufferSize = sizeof(uint32_t) * indices.size();
-	m_indexBuffer = std::make_shared<IndexBuffer>((void*)indices.data(), indexBufferSize);
+		const Bounds& bounds = m_mesh->GetBounds();
+		glm::vec3 extent = bounds.Max - bounds.Min;
+		float scale = 1.0f / std::max({ extent.x, extent.y, extent.z, 1e-6f });
+		m_meshTransform = glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * glm::translate(glm::mat4(1.0f), -(bounds.Min + bounds.Max) * 0.5f);
 
-	m_uniformBuffer = std::make_shared<UniformBuffer>(m_logicalDevice);
+		LOG("Mesh " << m_specification.MeshPath << ": " << m_mesh->GetMesh().VertexCount << " vertices, " << m_mesh->GetMesh().IndexCount / 3 << " triangles, " << m_mesh->GetSubmeshes().size() << " submeshes");
+	}
 
-	// Load a texture
-	m_image = std::make_shared<Image>("textures/texture.jpg");
+	// Every object pushes one aligned UniformBufferObject per frame, so the buffer grows with --objects instead
+	// of running full on the render thread in the middle of a run
+	VkDeviceSize uniformAlignment = m_physicalDevice->GetDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	VkDeviceSize objectUniformSize = (sizeof(UniformBufferObject) + uniformAlignment - 1) & ~(uniformAlignment - 1);
+	VkDeviceSize uniformSizePerFrame = std::max<VkDeviceSize>(VulkanConfig::UniformBufferSizePerFrame, objectUniformSize * m_specification.ObjectCount);
+
+	// Offsets into the buffer are 32 bit
+	if (uniformSizePerFrame * VulkanConfig::MaxFramesInFlight > UINT32_MAX)
+		throw std::runtime_error("Too many objects for the uniform buffer, lower --objects or the frames in flight!");
+
+	m_uniformBuffer = std::make_shared<UniformBuffer>(m_logicalDevice, (uint32_t)uniformSizePerFrame);
+
+	m_parallelRecorder = std::make_shared<ParallelRecorder>(m_logicalDevice);
+
+	// Textures load in the background and show a grey placeholder until they are resident. All come from the
+	// same file but are separate instances, so texture count scales memory, uploads and binds.
+	for (uint32_t i = 0; i < m_specification.TextureCount; i++)
+		m_textures.push_back(m_assetManager->LoadTexture("textures/texture.jpg", i));
 
 	// Sampler
 	VkSamplerCreateInfo samplerInfo{};
@@ -164,91 +241,208 @@ Application::Application()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // Images limit it to their own mip count
 
 	VK_CHECK(vkCreateSampler(m_logicalDevice->GetNativeDevice(), &samplerInfo, nullptr, &m_sampler), "Failed to create sampler!");
 
-	// Descriptor pool
+	// Descriptor pool, a set per frame in flight and texture
+	uint32_t descriptorSetCount = VulkanConfig::MaxFramesInFlight * m_specification.TextureCount;
+
 	VkDescriptorPoolSize poolSizeUbo{};
-	poolSizeUbo.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizeUbo.descriptorCount = VulkanConfig::MaxFramesInFlight;
+	poolSizeUbo.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizeUbo.descriptorCount = descriptorSetCount;
 
 	VkDescriptorPoolSize poolSizeSampler{};
 	poolSizeSampler.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizeSampler.descriptorCount = VulkanConfig::MaxFramesInFlight;
+	poolSizeSampler.descriptorCount = descriptorSetCount;
 
 	std::array<VkDescriptorPoolSize, 2> poolSizes = { poolSizeUbo, poolSizeSampler };
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = VulkanConfig::MaxFramesInFlight;
+	poolInfo.maxSets = descriptorSetCount;
 
 	VK_CHECK(vkCreateDescriptorPool(m_logicalDevice->GetNativeDevice(), &poolInfo, nullptr, &m_descriptorPool), "Failed to create descriptor pool!");
 
 	// Descriptor sets
-	std::vector<VkDescriptorSetLayout> layouts(VulkanConfig::MaxFramesInFlight, m_pipeline->GetDescriptorLayout());
+	std::vector<VkDescriptorSetLayout> layouts(descriptorSetCount, m_pipeline->GetDescriptorLayout());
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = m_descriptorPool;
 	allocInfo.descriptorSetCount = (uint32_t)layouts.size();
 	allocInfo.pSetLayouts = layouts.data();
 
-	m_descriptorSets.resize(VulkanConfig::MaxFramesInFlight);
+	m_descriptorSets.resize(descriptorSetCount);
 	VK_CHECK(vkAllocateDescriptorSets(m_logicalDevice->GetNativeDevice(), &allocInfo, m_descriptorSets.data()), "Failed to allocate descriptor sets!");
 
+	m_descriptorImageViews.resize(descriptorSetCount);
 	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
 	{
-		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = m_uniformBuffer->GetBuffers()[i];
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(UniformBufferObject);
-
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = m_image->GetImageView(); // TODO: MOVE THIS!!!
-		imageInfo.sampler = m_sampler;
-
-		VkWriteDescriptorSet writeDescriptorUbo{};
-		writeDescriptorUbo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorUbo.dstSet = m_descriptorSets[i];
-		writeDescriptorUbo.dstBinding = 0;
-		writeDescriptorUbo.dstArrayElement = 0;
-		writeDescriptorUbo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		writeDescriptorUbo.descriptorCount = 1;
-		writeDescriptorUbo.pBufferInfo = &bufferInfo;
-		writeDescriptorUbo.pImageInfo = nullptr;
-		writeDescriptorUbo.pTexelBufferView = nullptr;
-
-		VkWriteDescriptorSet writeDescriptorImage{};
-		writeDescriptorImage.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writeDescriptorImage.dstSet = m_descriptorSets[i];
-		writeDescriptorImage.dstBinding = 1;
-		writeDescriptorImage.dstArrayElement = 0;
-		writeDescriptorImage.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writeDescriptorImage.descriptorCount = 1;
-		writeDescriptorImage.pBufferInfo = nullptr;
-		writeDescriptorImage.pImageInfo = &imageInfo;
-		writeDescriptorImage.pTexelBufferView = nullptr;
-
-		std::array<VkWriteDescriptorSet, 2> writeDescriptors = { writeDescriptorUbo, writeDescriptorImage };
-		vkUpdateDescriptorSets(m_logicalDevice->GetNativeDevice(), (uint32_t)writeDescriptors.size(), writeDescriptors.data(), 0, nullptr);
+		for (uint32_t j = 0; j < m_specification.TextureCount; j++)
+			UpdateDescriptorSet(i, j);
+	}
+
+	if (m_specification.Benchmark)
+	{
+		m_benchmark = std::make_shared<FrameBenchmark>(VulkanConfig::BenchmarkWarmupFrames);
+		LOG("Benchmark: " << m_specification.FrameCount << " frames, " << m_specification.ObjectCount << " objects, " << m_specification.TextureCount << " textures");
 	}
 }
 
 void Application::Run()
 {
-	while (!glfwWindowShouldClose(m_window))
+	bool statsKeyDown = false;
+	bool defragmentKeyDown = false;
+	bool presentModeKeyDown = false;
+	bool frameLimitKeyDown = false;
+#ifndef VRELEASE
+	bool traceKeyDown = false;
+#endif
+
+	const VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+	uint32_t presentModeIndex = (uint32_t)(std::find(std::begin(presentModes), std::end(presentModes), m_specification.PresentMode) - std::begin(presentModes));
+
+	// Benchmarks and headless readbacks have to draw the same frames every run, so they don't start until
+	// the placeholders are gone instead of swapping on whatever frame an upload happens to finish
+	if (m_specification.Benchmark || m_specification.Headless)
+	{
+		PROFILE_SCOPE("Application::WaitForTextures");
+
+		for (const auto& texture : m_textures)
+			texture->WaitUntilResident();
+	}
+
+	// Simulation stays on this thread, rendering runs behind it on its own
+	if (m_specification.RenderThread)
+		m_renderThread = std::make_shared<RenderThread>([this](const FrameSnapshot& snapshot) { RenderFrame(snapshot); });
+
+	auto lastReport = std::chrono::high_resolution_clock::now();
+
+	PROFILE_THREAD("Main");
+
+#ifndef VRELEASE
+	if (m_specification.TraceFrames)
+		Profiler::CaptureFrames(m_specification.TraceFrames, m_specification.TracePath);
+#endif
+
+	while (m_specification.FrameCount ? m_frameNumber < m_specification.FrameCount : !glfwWindowShouldClose(m_window))
 	{
-		glfwPollEvents();
+		PROFILE_SCOPE("Application::Frame");
+
+		// Sleep before polling, so the frame reacts to the latest input
+		WaitForFrameLimit();
+
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		double blockedMs = 0.0;
+
+		m_inputTime = frameStart;
+
+		// Benchmarks take GPU times from here on, the samples of the frames before are warmup
+		if (m_benchmark && m_frameNumber == VulkanConfig::BenchmarkWarmupFrames)
+			m_gpuProfiler->BeginRecording(VulkanConfig::BenchmarkWarmupFrames);
+
+		// Headless runs have no window and no input, frames go out back to back
+		if (!m_specification.Headless)
+		{
+			glfwPollEvents();
+			m_inputTime = std::chrono::high_resolution_clock::now();
+
+			int width = 0, height = 0;
+			glfwGetFramebufferSize(m_window, &width, &height);
+			if (width == 0 || height == 0) // Window minimized
+			{
+				glfwWaitEvents();
+				continue;
+			}
+			m_renderTarget->SetFramebufferSize((uint32_t)width, (uint32_t)height);
+
+			// F2 dumps the GPU memory stats, F3 defragments
+			bool statsKeyPressed = glfwGetKey(m_window, GLFW_KEY_F2) == GLFW_PRESS;
+			if (statsKeyPressed && !statsKeyDown)
+				Allocator::DumpStats("memory_stats.json");
+			statsKeyDown = statsKeyPressed;
+
+			bool defragmentKeyPressed = glfwGetKey(m_window, GLFW_KEY_F3) == GLFW_PRESS;
+			if (defragmentKeyPressed && !defragmentKeyDown)
+				Allocator::Defragment();
+			defragmentKeyDown = defragmentKeyPressed;
+
+			// F4 cycles FIFO, MAILBOX and IMMEDIATE, F5 toggles the frame limiter at the monitor's refresh rate
+			bool presentModeKeyPressed = glfwGetKey(m_window, GLFW_KEY_F4) == GLFW_PRESS;
+			if (presentModeKeyPressed && !presentModeKeyDown)
+			{
+				presentModeIndex = (presentModeIndex + 1) % 3;
+				SetPresentMode(presentModes[presentModeIndex]);
+			}
+			presentModeKeyDown = presentModeKeyPressed;
 
-		m_swapchain->BeginFrame();
-		BeginFrame();
-		m_swapchain->Present();
+			bool frameLimitKeyPressed = glfwGetKey(m_window, GLFW_KEY_F5) == GLFW_PRESS;
+			if (frameLimitKeyPressed && !frameLimitKeyDown)
+				SetFrameLimit(m_frameLimit ? 0 : glfwGetVideoMode(glfwGetPrimaryMonitor())->refreshRate);
+			frameLimitKeyDown = frameLimitKeyPressed;
+
+#ifndef VRELEASE
+			// F6 starts a trace capture, the next press writes it
+			bool traceKeyPressed = glfwGetKey(m_window, GLFW_KEY_F6) == GLFW_PRESS;
+			if (traceKeyPressed && !traceKeyDown)
+			{
+				if (Profiler::IsCapturing())
+					Profiler::EndCapture(m_specification.TracePath);
+				else
+					Profiler::BeginCapture();
+			}
+			traceKeyDown = traceKeyPressed;
+#endif
+		}
+
+		if (m_renderThread)
+		{
+			FrameSnapshot& snapshot = m_renderThread->BeginSnapshot(blockedMs);
+			UpdateSnapshot(snapshot);
+			m_renderThread->Submit();
+		} else
+		{
+			UpdateSnapshot(m_snapshot);
+			RenderFrame(m_snapshot);
+		}
+
+		auto frameEnd = std::chrono::high_resolution_clock::now();
+		double mainMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count() - blockedMs;
+
+		if (m_benchmark)
+			m_benchmark->AddMainFrame(m_frameNumber - 1, mainMs);
+
+		{
+			std::lock_guard<std::mutex> lock(m_timingsMutex);
+			m_timings.MainMs += mainMs;
+			m_timings.BlockedMs += blockedMs;
+			m_timings.MainFrames++;
+		}
+
+		if (frameEnd - lastReport >= std::chrono::seconds(2))
+		{
+			ReportTimings();
+			lastReport = frameEnd;
+		}
+
+		PROFILE_FRAME();
 	}
 
+#ifndef VRELEASE
+	// A capture that is still running ends with the application
+	if (Profiler::IsCapturing())
+		Profiler::EndCapture(m_specification.TracePath);
+#endif
+
+	if (m_renderThread)
+		m_renderThread->Stop();
+
 	vkDeviceWaitIdle(m_logicalDevice->GetNativeDevice());
 
+	if (m_benchmark)
+		WriteBenchmarkReport();
+
 	Shutdown();
 }
 
@@ -257,37 +451,303 @@ void Application::Shutdown()
 	VkDevice device = m_logicalDevice->GetNativeDevice();
 
 	vkDestroySampler(device, m_sampler, nullptr);
-	m_swapchain->Cleanup();
+	m_renderTarget->Cleanup();
 	vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
 	m_pipeline->Destroy();
-	m_swapchain->Destroy();
+	m_parallelRecorder.reset();
+	m_renderTarget->Destroy();
+
+	// Destroy() hands out the last readbacks, their files have to be written before the job system goes
+	JobSystem::Wait(m_readbackWrites);
+
+	// GPU resources have to be released before the allocator and device go away, meshes before their pool
+	m_textures.clear();
+	m_mesh.reset();
+	m_assetManager.reset();
+	m_geometryPool.reset();
+	m_uniformBuffer.reset();
+
+	// Device is idle, so everything that was deferred can go
+	DeletionCommandQueue::Flush();
+
+	m_uploadContext->Destroy();
+	m_gpuProfiler->Destroy();
+	Allocator::Destroy();
 	m_logicalDevice->Destroy();
 
 	if (VulkanConfig::EnableValidation)
 		DestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
 
-	m_swapchain->DestroySurface();
 	vkDestroyInstance(m_instance, nullptr);
 
-	glfwDestroyWindow(m_window);
-	glfwTerminate();
+	JobSystem::Shutdown();
+
+	if (m_window)
+	{
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
+	}
+}
+
+void Application::UpdateSnapshot(FrameSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Application::UpdateSnapshot");
+
+	static auto startTime = std::chrono::high_resolution_clock::now();
+	auto currentTime = std::chrono::high_resolution_clock::now();
+	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+
+	// Benchmarks animate on a fixed timestep, so every run renders the same frames
+	if (m_benchmark)
+		time = m_frameNumber * VulkanConfig::BenchmarkTimestep;
+
+	snapshot.FrameNumber = m_frameNumber++;
+	snapshot.InputTime = m_inputTime;
+	snapshot.View = glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	// Objects fill a unit square in a grid, a single one covers all of it
+	uint32_t objectCount = m_specification.ObjectCount;
+	uint32_t gridSize = (uint32_t)std::ceil(std::sqrt((double)objectCount));
+	float cellSize = 1.0f / gridSize;
+
+	// Transforms are independent per object, large scenes spread them over the job system
+	snapshot.Objects.resize(objectCount);
+	JobSystem::ParallelFor(objectCount, 1024, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			glm::vec3 position((i % gridSize + 0.5f) * cellSize - 0.5f, (i / gridSize + 0.5f) * cellSize - 0.5f, 0.0f);
+
+			glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+			transform = glm::rotate(transform, time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+			transform = glm::scale(transform, glm::vec3(cellSize)) * m_meshTransform;
+
+			snapshot.Objects[i] = { m_mesh->GetMesh(), transform, i % m_specification.TextureCount };
+		}
+	});
 }
 
-void Application::BeginFrame()
+void Application::RenderFrame(const FrameSnapshot& snapshot)
 {
+	PROFILE_SCOPE("Application::RenderFrame");
+
+	auto renderStart = std::chrono::high_resolution_clock::now();
+
+	// Recycle upload batches the GPU is done with
+	m_uploadContext->Update();
+	m_assetManager->Update();
+
+	auto waitStart = std::chrono::high_resolution_clock::now();
+	m_renderTarget->BeginFrame();
+	double waitMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - waitStart).count();
+
+	// Moves resources before the frame is recorded so it already uses the new handles
+	Allocator::UpdateDefragmentation();
+	m_geometryPool->Update();
+
+	BeginFrame(snapshot);
+
+	// Uploads go in ahead of the frame that uses them
+	m_uploadContext->Submit();
+
+	waitStart = std::chrono::high_resolution_clock::now();
+	m_renderTarget->Present();
+	auto renderEnd = std::chrono::high_resolution_clock::now();
+	waitMs += std::chrono::duration<double, std::milli>(renderEnd - waitStart).count();
+
+	const PresentTiming& presentTiming = m_renderTarget->GetLastPresentTiming();
+	double inputToSubmitMs = std::chrono::duration<double, std::milli>(presentTiming.SubmitTime - snapshot.InputTime).count();
+	double submitToPresentMs = std::chrono::duration<double, std::milli>(presentTiming.PresentTime - presentTiming.SubmitTime).count();
+
+	double renderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+
+	if (m_benchmark)
+		m_benchmark->AddRenderFrame(snapshot.FrameNumber, renderMs);
+
+	std::lock_guard<std::mutex> lock(m_timingsMutex);
+	m_timings.RenderMs += renderMs;
+	m_timings.RenderWaitMs += waitMs;
+	m_timings.InputToSubmitMs += inputToSubmitMs;
+	m_timings.SubmitToPresentMs += submitToPresentMs;
+	m_timings.MaxInputToSubmitMs = std::max(m_timings.MaxInputToSubmitMs, inputToSubmitMs);
+	m_timings.MaxSubmitToPresentMs = std::max(m_timings.MaxSubmitToPresentMs, submitToPresentMs);
+	m_timings.RenderFrames++;
+}
+
+void Application::ReportTimings()
+{
+	FrameTimings timings;
+	{
+		std::lock_guard<std::mutex> lock(m_timingsMutex);
+		timings = m_timings;
+		m_timings = {};
+	}
+
+	if (timings.MainFrames == 0 || timings.RenderFrames == 0)
+		return;
+
+	double mainMs = timings.MainMs / timings.MainFrames;
+	double blockedMs = timings.BlockedMs / timings.MainFrames;
+	double renderMs = timings.RenderMs / timings.RenderFrames;
+	double renderWaitMs = timings.RenderWaitMs / timings.RenderFrames;
+
+	// On the main thread the simulation pays for all of the render time, on the render thread only for what doesn't overlap
+	double recoveredMs = m_renderThread ? renderMs - blockedMs : 0.0;
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(2);
+	ss << "[Frame] main " << mainMs << " ms (" << blockedMs << " ms blocked), render " << renderMs << " ms (" << renderWaitMs << " ms fence/present)";
+	ss << ", recovered " << recoveredMs << " ms per frame";
+	LOG(ss.str());
+
+	std::stringstream latency;
+	latency << std::fixed << std::setprecision(2);
+	latency << "[Latency] input to submit " << timings.InputToSubmitMs / timings.RenderFrames << " ms (max " << timings.MaxInputToSubmitMs << ")";
+	latency << ", submit to present " << timings.SubmitToPresentMs / timings.RenderFrames << " ms (max " << timings.MaxSubmitToPresentMs << ")";
+	latency << ", " << m_renderTarget->GetPresentModeName() << ", limit ";
+	if (m_frameLimit)
+		latency << m_frameLimit << " fps";
+	else
+		latency << "off";
+	LOG(latency.str());
+
+	// Read back a few frames late, so these trail the CPU timings slightly
+	auto gpuStats = m_gpuProfiler->GetStats();
+	if (!gpuStats.empty())
+	{
+		std::stringstream gpu;
+		gpu << std::fixed << std::setprecision(3);
+		gpu << "[GPU]";
+		for (const auto& zone : gpuStats)
+			gpu << " " << zone.Name << " " << zone.AvgMs << " ms (" << zone.MinMs << " - " << zone.MaxMs << ")";
+		LOG(gpu.str());
+	}
+
+	AssetStats assetStats = m_assetManager->GetStats();
+	std::stringstream assets;
+	assets << std::fixed << std::setprecision(2);
+	assets << "[Assets] " << assetStats.Count << " assets, " << assetStats.Bytes / (1024.0 * 1024.0) << " MB (" << assetStats.Unreferenced << " unreferenced, ";
+	assets << assetStats.UnreferencedBytes / (1024.0 * 1024.0) << " MB), " << assetStats.Hits << " hits, " << assetStats.Misses << " misses, " << assetStats.Evictions << " evictions";
+	LOG(assets.str());
+}
+
+void Application::WaitForFrameLimit()
+{
+	PROFILE_SCOPE("Application::WaitForFrameLimit");
+
+	auto now = std::chrono::high_resolution_clock::now();
+
+	if (m_frameLimit == 0)
+	{
+		m_nextFrameTime = now;
+		return;
+	}
+
+	// Paced from the previous deadline rather than from now, so oversleeping doesn't add up. After a
+	// hitch the schedule restarts instead of rushing frames to catch up.
+	if (m_nextFrameTime > now)
+		std::this_thread::sleep_until(m_nextFrameTime);
+	else
+		m_nextFrameTime = now;
+
+	m_nextFrameTime += std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(1.0 / m_frameLimit));
+}
+
+void Application::SetPresentMode(VkPresentModeKHR presentMode)
+{
+	m_renderTarget->SetPresentMode(presentMode);
+	LOG("Present mode " << Swapchain::GetPresentModeName(presentMode));
+}
+
+void Application::SetFrameLimit(uint32_t framesPerSecond)
+{
+	m_frameLimit = framesPerSecond;
+	LOG("Frame limit " << framesPerSecond << " fps");
+}
+
+void Application::WriteReadback(const ReadbackFrame& frame)
+{
+	// The pixels are only valid during the callback, so they are copied and the file is written on a worker
+	auto pixels = std::make_shared<std::vector<uint8_t>>(frame.Pixels, frame.Pixels + (size_t)frame.Width * frame.Height * 4);
+
+	std::stringstream path;
+	path << m_specification.ReadbackPath << "/frame_" << std::setw(5) << std::setfill('0') << frame.FrameNumber << ".ppm";
+
+	JobSystem::RunBackground([pixels, path = path.str(), width = frame.Width, height = frame.Height]()
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+		{
+			LOG("Failed to open " << path << " for writing!");
+			return;
+		}
+
+		file << "P6\n" << width << " " << height << "\n255\n";
+
+		// RGBA to RGB
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const uint8_t* src = pixels->data() + (size_t)y * width * 4;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = src[x * 4 + 0];
+				row[x * 3 + 1] = src[x * 4 + 1];
+				row[x * 3 + 2] = src[x * 4 + 2];
+			}
+
+			file.write((const char*)row.data(), row.size());
+		}
+	}, &m_readbackWrites);
+}
+
+void Application::BeginFrame(const FrameSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Application::BeginFrame");
+
+	uint32_t frameIndex = m_renderTarget->GetCurrentFrameIndex();
+	VkExtent2D extent = m_renderTarget->GetExtent();
+
+	// Per object uniforms, the GPU is done with this frame's region of the uniform buffer
+	m_uniformBuffer->Reset(frameIndex);
+
+	// The sets of this frame are no longer in use, so they can pick up textures that finished loading and image
+	// views that were moved by the defragmenter
+	for (uint32_t i = 0; i < m_specification.TextureCount; i++)
+	{
+		if (m_descriptorImageViews[frameIndex * m_specification.TextureCount + i] != m_textures[i]->GetImageView())
+			UpdateDescriptorSet(frameIndex, i);
+	}
+
+	UniformBufferObject ubo;
+	ubo.View = snapshot.View;
+	ubo.Projection = glm::perspective(glm::radians(45.0f), extent.width / (float)extent.height, 0.1f, 10.0f);
+	ubo.Projection[1][1] *= -1;
+
+	m_drawList.clear();
+	for (const auto& object : snapshot.Objects)
+	{
+		ubo.Model = object.Transform;
+		m_drawList.push_back({ object.Geometry, m_uniformBuffer->Push(ubo), object.TextureIndex });
+	}
+	m_uniformBuffer->Flush();
+
+	VkCommandBuffer commandBuffer = m_renderTarget->GetRenderCommandBuffer();
+
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = 0;
 	beginInfo.pInheritanceInfo = nullptr;
 
-	VK_CHECK(vkBeginCommandBuffer(m_swapchain->GetRenderCommandBuffer(), &beginInfo), "Failed to begin command buffer!");
+	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin command buffer!");
 
-	VkExtent2D extent = m_swapchain->GetExtent();
+	m_gpuProfiler->BeginFrame(commandBuffer, frameIndex, snapshot.FrameNumber);
+	uint32_t frameZone = m_gpuProfiler->BeginZone(commandBuffer, "Frame");
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_swapchain->GetRenderPass();
-	renderPassInfo.framebuffer = m_swapchain->GetCurrentFramebuffer();
+	renderPassInfo.renderPass = m_renderTarget->GetRenderPass();
+	renderPassInfo.framebuffer = m_renderTarget->GetCurrentFramebuffer();
 	renderPassInfo.renderArea.offset = { 0, 0 };
 	renderPassInfo.renderArea.extent = extent;
 
@@ -295,8 +755,38 @@ void Application::BeginFrame()
 	renderPassInfo.clearValueCount = 1;
 	renderPassInfo.pClearValues = &clearColor;
 
-	vkCmdBeginRenderPass(m_swapchain->GetRenderCommandBuffer(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(m_swapchain->GetRenderCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipeline());
+	// Large draw lists are split over worker threads that each record a secondary command buffer
+	uint32_t drawCount = (uint32_t)m_drawList.size();
+	bool recordParallel = drawCount >= VulkanConfig::ParallelRecordingMinDraws;
+
+	uint32_t renderPassZone = m_gpuProfiler->BeginZone(commandBuffer, "RenderPass");
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, recordParallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	if (recordParallel)
+	{
+		m_parallelRecorder->Record(commandBuffer, frameIndex, renderPassInfo.renderPass, renderPassInfo.framebuffer, drawCount, [&](VkCommandBuffer secondaryCommandBuffer, uint32_t begin, uint32_t end)
+		{
+			RecordDraws(secondaryCommandBuffer, frameIndex, begin, end);
+		});
+	} else
+	{
+		// Timestamps can't go between the secondary command buffers, so draws are only timed on their own when inline
+		GpuProfileScope drawZone(*m_gpuProfiler, commandBuffer, "Draws");
+		RecordDraws(commandBuffer, frameIndex, 0, drawCount);
+	}
+
+	vkCmdEndRenderPass(commandBuffer);
+	m_gpuProfiler->EndZone(commandBuffer, renderPassZone);
+	m_gpuProfiler->EndZone(commandBuffer, frameZone);
+
+	VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to record command buffer!");
+}
+
+void Application::RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t begin, uint32_t end)
+{
+	VkExtent2D extent = m_renderTarget->GetExtent();
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipeline());
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
@@ -305,25 +795,81 @@ void Application::BeginFrame()
 	viewport.height = (float)extent.height;
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(m_swapchain->GetRenderCommandBuffer(), 0, 1, &viewport);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
 	scissor.extent = extent;
-	vkCmdSetScissor(m_swapchain->GetRenderCommandBuffer(), 0, 1, &scissor);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	VkBuffer vbo[]{ m_vertexBuffer->GetBuffer() };
-	VkDeviceSize offsets[]{ 0 };
-	vkCmdBindVertexBuffers(m_swapchain->GetRenderCommandBuffer(), 0, 1, vbo, offsets);
-	vkCmdBindIndexBuffer(m_swapchain->GetRenderCommandBuffer(), m_indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	// All meshes live in the geometry pool, one bind for the whole frame
+	m_geometryPool->Bind(commandBuffer);
 
-	vkCmdBindDescriptorSets(m_swapchain->GetRenderCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, 1, &m_descriptorSets[m_swapchain->GetCurrentImageIndex()], 0, nullptr);
-	
-	vkCmdDrawIndexed(m_swapchain->GetRenderCommandBuffer(), (uint32_t)indices.size(), 1, 0, 0, 0);
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const DrawItem& item = m_drawList[i];
 
-	vkCmdEndRenderPass(m_swapchain->GetRenderCommandBuffer());
+		VkDescriptorSet descriptorSet = m_descriptorSets[frameIndex * m_specification.TextureCount + item.TextureIndex];
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 1, &item.UniformOffset);
+		m_geometryPool->Draw(commandBuffer, item.Geometry);
+	}
+}
 
-	VK_CHECK(vkEndCommandBuffer(m_swapchain->GetRenderCommandBuffer()), "Failed to record command buffer!");
+void Application::UpdateDescriptorSet(uint32_t frameIndex, uint32_t textureIndex)
+{
+	uint32_t setIndex = frameIndex * m_specification.TextureCount + textureIndex;
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_uniformBuffer->GetBuffer();
+	bufferInfo.offset = 0; // Per object dynamic offset is added on bind
+	bufferInfo.range = sizeof(UniformBufferObject);
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = m_textures[textureIndex]->GetImageView();
+	imageInfo.sampler = m_sampler;
+
+	VkWriteDescriptorSet writeDescriptorUbo{};
+	writeDescriptorUbo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorUbo.dstSet = m_descriptorSets[setIndex];
+	writeDescriptorUbo.dstBinding = 0;
+	writeDescriptorUbo.dstArrayElement = 0;
+	writeDescriptorUbo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	writeDescriptorUbo.descriptorCount = 1;
+	writeDescriptorUbo.pBufferInfo = &bufferInfo;
+	writeDescriptorUbo.pImageInfo = nullptr;
+	writeDescriptorUbo.pTexelBufferView = nullptr;
+
+	VkWriteDescriptorSet writeDescriptorImage{};
+	writeDescriptorImage.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeDescriptorImage.dstSet = m_descriptorSets[setIndex];
+	writeDescriptorImage.dstBinding = 1;
+	writeDescriptorImage.dstArrayElement = 0;
+	writeDescriptorImage.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writeDescriptorImage.descriptorCount = 1;
+	writeDescriptorImage.pBufferInfo = nullptr;
+	writeDescriptorImage.pImageInfo = &imageInfo;
+	writeDescriptorImage.pTexelBufferView = nullptr;
+
+	std::array<VkWriteDescriptorSet, 2> writeDescriptors = { writeDescriptorUbo, writeDescriptorImage };
+	vkUpdateDescriptorSets(m_logicalDevice->GetNativeDevice(), (uint32_t)writeDescriptors.size(), writeDescriptors.data(), 0, nullptr);
+
+	m_descriptorImageViews[setIndex] = imageInfo.imageView;
+}
+
+void Application::WriteBenchmarkReport()
+{
+	std::stringstream settings;
+	settings << std::fixed << std::setprecision(4);
+	settings << "{ \"Device\": \"" << m_physicalDevice->GetDeviceProperties().deviceName << "\"";
+	settings << ", \"Frames\": " << m_specification.FrameCount << ", \"WarmupFrames\": " << VulkanConfig::BenchmarkWarmupFrames;
+	settings << ", \"Timestep\": " << VulkanConfig::BenchmarkTimestep;
+	settings << ", \"Objects\": " << m_specification.ObjectCount << ", \"Textures\": " << m_specification.TextureCount << ", \"Mipmaps\": " << (m_specification.Mipmaps ? "true" : "false");
+	settings << ", \"FramesInFlight\": " << VulkanConfig::MaxFramesInFlight << ", \"RenderThread\": " << (m_renderThread ? "true" : "false");
+	settings << ", \"Target\": \"" << m_renderTarget->GetPresentModeName() << "\"";
+	settings << ", \"Width\": " << m_renderTarget->GetWidth() << ", \"Height\": " << m_renderTarget->GetHeight() << " }";
+
+	m_benchmark->WriteReport(m_specification.BenchmarkPath, settings.str(), m_gpuProfiler->EndRecording());
 }
 
 bool Application::HasValidationLayerSupport()
@@ -356,10 +902,16 @@ bool Application::HasValidationLayerSupport()
 
 std::vector<const char*> Application::GetRequiredExtensions()
 {
-	uint32_t glfwExtensionCount{ 0 };
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions;
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	// Surface extensions are only needed to present to the window
+	if (!m_specification.Headless)
+	{
+		uint32_t glfwExtensionCount{ 0 };
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (VulkanConfig::EnableValidation)
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
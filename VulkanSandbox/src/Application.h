@@ -4,39 +4,123 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "Assets/AssetManager.h"
+#include "Benchmark/FrameBenchmark.h"
+#include "Buffer/GeometryPool.h"
 #include "Buffer/IndexBuffer.h"
 #include "Buffer/UniformBuffer.h"
 #include "Buffer/VertexBuffer.h"
 #include "Device/LogicalDevice.h"
+#include "Device/HeadlessTarget.h"
 #include "Device/PhysicalDevice.h"
 #include "Device/Swapchain.h"
+#include "Device/UploadContext.h"
+#include "Jobs/JobSystem.h"
+#include "Profiling/GpuProfiler.h"
 #include "Renderable/Image.h"
+#include "Renderable/Texture.h"
+#include "ParallelRecorder.h"
 #include "Pipeline.h"
+#include "RenderThread.h"
 #include "Vulkan.h"
 
+struct DrawItem
+{
+	Mesh Geometry;
+	uint32_t UniformOffset;
+	uint32_t TextureIndex;
+};
+
+struct ApplicationSpecification
+{
+	bool RenderThread = true;
+	uint32_t FramesInFlight = 2; // 1 to VulkanConfig::MaxFramesInFlightLimit, more trades latency for throughput
+	VkPresentModeKHR PresentMode = VK_PRESENT_MODE_MAILBOX_KHR; // Falls back to FIFO when unsupported
+	uint32_t FrameLimit = 0; // Frames per second, 0 disables the limiter
+
+	uint32_t FrameCount = 0; // Stops after this many frames, 0 runs until the window is closed
+
+	// Renders offscreen without a window, 600 frames unless FrameCount says otherwise
+	bool Headless = false;
+	std::string ReadbackPath; // Headless frames are written here as PPM when set
+
+	std::string MeshPath; // A .vmesh file drawn instead of the built-in quads, scaled to fit
+
+	// Scene scale, objects are laid out in a grid and cycle through the textures
+	uint32_t ObjectCount = 1;
+	uint32_t TextureCount = 1;
+	bool Mipmaps = true; // Full mip chains for textures, off to compare sampling cost in benchmarks
+
+	// Runs FrameCount frames (1000 by default) on a fixed timestep and writes frame time percentiles,
+	// GPU zone times and memory use to BenchmarkPath
+	bool Benchmark = false;
+	std::string BenchmarkPath = "benchmark.json";
+
+	// Chrome trace of the first frames, not available in Release
+	uint32_t TraceFrames = 0;
+	std::string TracePath = "trace.json";
+};
+
+// CPU time per frame, averaged over the reporting interval
+struct FrameTimings
+{
+	double MainMs = 0.0; // Simulation, without waiting on the render thread
+	double BlockedMs = 0.0; // Main thread waiting for a free snapshot
+	double RenderMs = 0.0;
+	double RenderWaitMs = 0.0; // Fence, acquire and present
+
+	// Latency of the frames rendered
+	double InputToSubmitMs = 0.0;
+	double SubmitToPresentMs = 0.0;
+	double MaxInputToSubmitMs = 0.0;
+	double MaxSubmitToPresentMs = 0.0;
+
+	uint32_t MainFrames = 0;
+	uint32_t RenderFrames = 0;
+};
+
 class Application
 {
 public:
-	Application();
+	Application(const ApplicationSpecification& specification = {});
 
 	static Application& Get() { return *s_instance; }
 	VkInstance GetInstance() { return m_instance; }
 	GLFWwindow* GetWindow() { return m_window; }
 
+	const std::shared_ptr<PhysicalDevice>& GetPhysicalDevice() const { return m_physicalDevice; }
 	const std::shared_ptr<LogicalDevice>& GetDevice() const { return m_logicalDevice; }
-	const std::shared_ptr<Swapchain>& GetSwapchain() const { return m_swapchain; }
+	const std::shared_ptr<RenderTarget>& GetRenderTarget() const { return m_renderTarget; }
+	const std::shared_ptr<UploadContext>& GetUploadContext() const { return m_uploadContext; }
+	const std::shared_ptr<GpuProfiler>& GetGpuProfiler() const { return m_gpuProfiler; }
 	const std::shared_ptr<UniformBuffer>& GetUniformBuffer() const { return m_uniformBuffer; }
+	const std::shared_ptr<GeometryPool>& GetGeometryPool() const { return m_geometryPool; }
+	const std::shared_ptr<AssetManager>& GetAssetManager() const { return m_assetManager; }
 
 	void Run();
 	void Shutdown();
+
+	// Main thread only, both take effect from the next frame on
+	void SetPresentMode(VkPresentModeKHR presentMode);
+	void SetFrameLimit(uint32_t framesPerSecond);
 	
 private:
-	void BeginFrame();
+	void UpdateSnapshot(FrameSnapshot& snapshot);
+	void RenderFrame(const FrameSnapshot& snapshot);
+	void BeginFrame(const FrameSnapshot& snapshot);
+	void ReportTimings();
+	void WaitForFrameLimit();
+	void RecordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t begin, uint32_t end);
+	void UpdateDescriptorSet(uint32_t frameIndex, uint32_t textureIndex);
+	void WriteReadback(const ReadbackFrame& frame);
+	void WriteBenchmarkReport();
 
 	bool HasValidationLayerSupport();
 	std::vector<const char*> GetRequiredExtensions();
 
 private:
+	ApplicationSpecification m_specification;
+
 	GLFWwindow* m_window{ nullptr };
 	VkInstance m_instance;
 	VkDebugUtilsMessengerEXT m_debugMessenger;
@@ -45,19 +129,41 @@ private:
 
 	std::shared_ptr<PhysicalDevice> m_physicalDevice;
 	std::shared_ptr<LogicalDevice> m_logicalDevice;
-	std::shared_ptr<Swapchain> m_swapchain;
+	std::shared_ptr<RenderTarget> m_renderTarget; // Swapchain, or a HeadlessTarget when running headless
 	std::shared_ptr<Pipeline> m_pipeline;
+	std::shared_ptr<UploadContext> m_uploadContext;
+	std::shared_ptr<AssetManager> m_assetManager;
+	std::shared_ptr<GpuProfiler> m_gpuProfiler;
+	std::shared_ptr<ParallelRecorder> m_parallelRecorder;
 
 	bool m_framebufferResized{ false };
 
-	std::shared_ptr<VertexBuffer> m_vertexBuffer;
-	std::shared_ptr<IndexBuffer> m_indexBuffer;
+	std::shared_ptr<GeometryPool> m_geometryPool;
 	std::shared_ptr<UniformBuffer> m_uniformBuffer;
+	std::shared_ptr<StaticMesh> m_mesh;
+	glm::mat4 m_meshTransform{ 1.0f }; // Fits the mesh into a unit cube around the origin
+	std::vector<DrawItem> m_drawList;
 
-	std::shared_ptr<Image> m_image;
+	std::shared_ptr<RenderThread> m_renderThread;
+	FrameSnapshot m_snapshot; // Used when rendering on the main thread
+	uint64_t m_frameNumber = 0;
+
+	FrameTimings m_timings;
+	std::mutex m_timingsMutex;
+
+	uint32_t m_frameLimit = 0;
+	std::chrono::high_resolution_clock::time_point m_nextFrameTime;
+	std::chrono::high_resolution_clock::time_point m_inputTime;
+
+	JobCounter m_readbackWrites; // PPM files still being written
+
+	std::vector<std::shared_ptr<Texture>> m_textures;
 	VkSampler m_sampler;
 
 	// Shader? Renderer?
 	VkDescriptorPool m_descriptorPool;
-	std::vector<VkDescriptorSet> m_descriptorSets;
+	std::vector<VkDescriptorSet> m_descriptorSets; // Per frame in flight and texture, frameIndex * TextureCount + textureIndex
+	std::vector<VkImageView> m_descriptorImageViews; // What each set was last written with
+
+	std::shared_ptr<FrameBenchmark> m_benchmark;
 };
\ No newline at end of file
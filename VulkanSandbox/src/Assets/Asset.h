@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../Vulkan.h"
+
+// Anything the AssetManager caches
+class Asset
+{
+public:
+	virtual ~Asset() = default;
+
+	// Device memory held by the asset, counted against the cache budget. 0 while it is still loading.
+	virtual VkDeviceSize GetMemorySize() = 0;
+};
\ No newline at end of file
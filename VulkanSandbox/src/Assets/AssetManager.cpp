@@ -0,0 +1,268 @@
+#include "AssetManager.h"
+
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+
+// FNV-1a, good enough to tell files apart and much cheaper than decoding them
+static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+	return hash;
+}
+
+static std::string GetKey(AssetType type, const std::string& path)
+{
+	return std::to_string((uint32_t)type) + ":" + path;
+}
+
+AssetManager::AssetManager(VkDeviceSize budget)
+	: m_budget(budget)
+{
+	ImageData placeholderData;
+	placeholderData.Width = 1;
+	placeholderData.Height = 1;
+	placeholderData.Pixels = { 128, 128, 128, 255 };
+	m_placeholder = std::make_shared<Image>(placeholderData);
+}
+
+AssetManager::~AssetManager()
+{
+	Clear();
+
+	if (!m_entries.empty())
+		LOG("[Assets] " << m_entries.size() << " assets are still referenced while the asset manager goes away");
+
+	// Textures that are still referenced keep their own reference to it
+	m_placeholder.reset();
+}
+
+std::shared_ptr<Texture> AssetManager::LoadTexture(const std::filesystem::path& filepath, uint32_t instance)
+{
+	PROFILE_SCOPE("AssetManager::LoadTexture");
+
+	// Keyed on the file that is actually loaded, a JPEG can have a different KTX2 variant next to it at every path
+	std::filesystem::path resolved = Texture::FindCompressedVariant(filepath.lexically_normal());
+	std::string path = resolved.generic_string();
+	if (instance > 0)
+		path += "#" + std::to_string(instance);
+
+	// Reading the whole file here would put the decode job's I/O back on the caller. Size and write time
+	// pick up changes on disk, missing files hash as size 0 and are only shared by path.
+	std::error_code error;
+	uint64_t size = std::filesystem::file_size(resolved, error);
+	if (error)
+		size = 0;
+	int64_t writeTime = std::filesystem::last_write_time(resolved, error).time_since_epoch().count();
+	if (error)
+		writeTime = 0;
+
+	uint64_t contentHash = Hash(path.data(), path.size());
+	contentHash = Hash(&size, sizeof(size), contentHash);
+	contentHash = Hash(&writeTime, sizeof(writeTime), contentHash);
+	contentHash = Hash(&instance, sizeof(instance), contentHash);
+
+	return Load<Texture>(AssetType::Texture, path, contentHash, [&]() { return std::make_shared<Texture>(resolved, m_placeholder); });
+}
+
+std::shared_ptr<ShaderModule> AssetManager::LoadShader(const std::filesystem::path& filepath)
+{
+	PROFILE_SCOPE("AssetManager::LoadShader");
+
+	std::string path = filepath.lexically_normal().generic_string();
+	std::vector<char> contents = ReadBytes(path);
+
+	if (contents.empty())
+		throw std::runtime_error("Failed to read shader " + path + "!");
+
+	return Load<ShaderModule>(AssetType::Shader, path, Hash(contents.data(), contents.size()), [&]() { return std::make_shared<ShaderModule>(contents); });
+}
+
+std::shared_ptr<StaticMesh> AssetManager::LoadMesh(const std::filesystem::path& filepath)
+{
+	PROFILE_SCOPE("AssetManager::LoadMesh");
+
+	std::string path = filepath.lexically_normal().generic_string();
+	MappedFile file(path);
+
+	// The importer stores the hash in the header, so a cache hit never touches the data
+	uint64_t contentHash = StaticMesh::GetContentHash(file);
+	if (contentHash == 0)
+		throw std::runtime_error("Failed to load mesh " + path + "!");
+
+	return Load<StaticMesh>(AssetType::Mesh, path, contentHash, [&]() { return std::make_shared<StaticMesh>(file); });
+}
+
+std::shared_ptr<StaticMesh> AssetManager::LoadMesh(const std::string& name, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	PROFILE_SCOPE("AssetManager::LoadMesh");
+
+	uint64_t contentHash = Hash(indices, indexCount * sizeof(uint32_t), Hash(vertices, vertexCount * sizeof(Vertex)));
+
+	return Load<StaticMesh>(AssetType::Mesh, name, contentHash, [&]() { return std::make_shared<StaticMesh>(vertices, vertexCount, indices, indexCount); });
+}
+
+template<typename T, typename CreateFn>
+std::shared_ptr<T> AssetManager::Load(AssetType type, const std::string& path, uint64_t contentHash, CreateFn&& create)
+{
+	std::string key = GetKey(type, path);
+
+	// The same bytes can be a texture and a mesh at the same time
+	contentHash = Hash(&type, sizeof(type), contentHash);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto keyIt = m_keys.find(key);
+		if (keyIt != m_keys.end() && keyIt->second != contentHash)
+		{
+			// The file changed on disk (or a mesh name was reused), the old asset stays with whoever still holds it
+			Entry& stale = m_entries[keyIt->second];
+			stale.Keys.erase(std::remove(stale.Keys.begin(), stale.Keys.end(), key), stale.Keys.end());
+			m_keys.erase(keyIt);
+		}
+
+		if (std::shared_ptr<T> asset = Find<T>(key, contentHash))
+		{
+			m_hits++;
+			return asset;
+		}
+	}
+
+	// Created without the lock, so loads on other threads don't queue up behind uploads and shader creation
+	std::shared_ptr<T> created = create();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Another thread loaded the same contents in the meantime, theirs is kept and ours goes once the lock is released
+	if (std::shared_ptr<T> asset = Find<T>(key, contentHash))
+	{
+		m_hits++;
+		return asset;
+	}
+
+	Entry& entry = m_entries[contentHash];
+	entry.Resource = created;
+	entry.Type = type;
+	entry.Keys.push_back(key);
+	entry.LastUsed = m_frame;
+
+	m_keys[key] = contentHash;
+	m_misses++;
+
+	return created;
+}
+
+template<typename T>
+std::shared_ptr<T> AssetManager::Find(const std::string& key, uint64_t contentHash)
+{
+	auto it = m_entries.find(contentHash);
+	if (it == m_entries.end())
+		return nullptr;
+
+	if (std::find(it->second.Keys.begin(), it->second.Keys.end(), key) == it->second.Keys.end())
+		it->second.Keys.push_back(key);
+
+	m_keys[key] = contentHash;
+	it->second.LastUsed = m_frame;
+
+	return std::static_pointer_cast<T>(it->second.Resource);
+}
+
+void AssetManager::Update()
+{
+	PROFILE_SCOPE("AssetManager::Update");
+
+	// Released after the lock, destroying a texture waits on its load job and runs other jobs meanwhile
+	std::vector<std::shared_ptr<Asset>> evicted;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_frame++;
+
+	VkDeviceSize total = 0;
+	std::vector<std::pair<uint64_t, uint64_t>> unreferenced; // Last used and content hash
+
+	for (auto& [contentHash, entry] : m_entries)
+	{
+		entry.Size = entry.Resource->GetMemorySize();
+		total += entry.Size;
+
+		if (entry.Resource.use_count() > 1)
+			entry.LastUsed = m_frame;
+		else
+			unreferenced.push_back({ entry.LastUsed, contentHash });
+	}
+
+	if (total <= m_budget)
+		return;
+
+	// Least recently used first, referenced assets can't go however far over budget the cache is
+	std::sort(unreferenced.begin(), unreferenced.end());
+
+	for (const auto& [lastUsed, contentHash] : unreferenced)
+	{
+		if (total <= m_budget)
+			break;
+
+		total -= m_entries[contentHash].Size;
+		evicted.push_back(Evict(contentHash));
+	}
+}
+
+void AssetManager::Clear()
+{
+	std::vector<std::shared_ptr<Asset>> evicted;
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<uint64_t> unreferenced;
+	for (const auto& [contentHash, entry] : m_entries)
+	{
+		if (entry.Resource.use_count() == 1)
+			unreferenced.push_back(contentHash);
+	}
+
+	for (uint64_t contentHash : unreferenced)
+		evicted.push_back(Evict(contentHash));
+}
+
+AssetStats AssetManager::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	AssetStats stats;
+	stats.Hits = m_hits;
+	stats.Misses = m_misses;
+	stats.Evictions = m_evictions;
+
+	for (const auto& [contentHash, entry] : m_entries)
+	{
+		stats.Count++;
+		stats.Bytes += entry.Size;
+
+		if (entry.Resource.use_count() == 1)
+		{
+			stats.Unreferenced++;
+			stats.UnreferencedBytes += entry.Size;
+		}
+	}
+
+	return stats;
+}
+
+std::shared_ptr<Asset> AssetManager::Evict(uint64_t contentHash)
+{
+	auto it = m_entries.find(contentHash);
+	std::shared_ptr<Asset> asset = std::move(it->second.Resource);
+
+	for (const auto& key : it->second.Keys)
+		m_keys.erase(key);
+
+	m_entries.erase(it);
+	m_evictions++;
+
+	return asset;
+}
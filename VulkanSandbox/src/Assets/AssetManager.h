@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ShaderModule.h"
+#include "StaticMesh.h"
+#include "../Renderable/Texture.h"
+
+#include <mutex>
+#include <unordered_map>
+
+enum class AssetType : uint8_t
+{
+	Texture = 0,
+	Shader,
+	Mesh
+};
+
+struct AssetStats
+{
+	uint32_t Count = 0;
+	uint32_t Unreferenced = 0; // Only kept alive by the cache
+	VkDeviceSize Bytes = 0;
+	VkDeviceSize UnreferencedBytes = 0;
+
+	uint64_t Hits = 0;
+	uint64_t Misses = 0;
+	uint64_t Evictions = 0;
+};
+
+// Cache of loaded assets, keyed by path and by a hash of their contents. Loading a path again, or another
+// path with the same contents, shares the asset that is already there. Textures are the exception, they
+// are identified by the file they load, its size and write time, so loading one doesn't read the file
+// twice. Assets are handed out as shared pointers, once the last one outside the cache is gone they stay
+// cached until the cache goes over its budget, then the least recently used are evicted first.
+class AssetManager
+{
+public:
+	AssetManager(VkDeviceSize budget = VulkanConfig::AssetCacheBudget);
+	~AssetManager();
+
+	// Any thread. Other instances of the same file are separate images, for scenes that scale texture memory.
+	std::shared_ptr<Texture> LoadTexture(const std::filesystem::path& filepath, uint32_t instance = 0);
+	std::shared_ptr<ShaderModule> LoadShader(const std::filesystem::path& filepath);
+	// A .vmesh file, mapped and copied straight into staging memory
+	std::shared_ptr<StaticMesh> LoadMesh(const std::filesystem::path& filepath);
+	// Geometry built in code, the name takes the place of the path
+	std::shared_ptr<StaticMesh> LoadMesh(const std::string& name, const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+	// Render thread, once per frame. Updates the sizes and evicts while over budget.
+	void Update();
+	// Drops every unreferenced asset, whatever the budget
+	void Clear();
+
+	// Any thread, sizes are the ones of the last Update()
+	AssetStats GetStats();
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Asset> Resource;
+		AssetType Type;
+		std::vector<std::string> Keys; // Every path that resolved to it
+		VkDeviceSize Size = 0;
+		uint64_t LastUsed = 0; // Last frame it was referenced outside the cache
+	};
+
+	template<typename T, typename CreateFn>
+	std::shared_ptr<T> Load(AssetType type, const std::string& path, uint64_t contentHash, CreateFn&& create);
+	// With the lock held, adds the key to an existing entry
+	template<typename T>
+	std::shared_ptr<T> Find(const std::string& key, uint64_t contentHash);
+
+	// With the lock held, the asset is handed back so it can be released after unlocking
+	std::shared_ptr<Asset> Evict(uint64_t contentHash);
+
+private:
+	VkDeviceSize m_budget;
+
+	std::unordered_map<uint64_t, Entry> m_entries; // By content hash
+	std::unordered_map<std::string, uint64_t> m_keys; // Type and path to content hash
+
+	std::shared_ptr<Image> m_placeholder; // Bound in place of textures that are still loading, never changes
+
+	uint64_t m_frame = 0;
+	uint64_t m_hits = 0;
+	uint64_t m_misses = 0;
+	uint64_t m_evictions = 0;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
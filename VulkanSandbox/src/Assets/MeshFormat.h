@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary mesh container (.vmesh), written by the MeshImporter and used straight from a file mapping at load.
+// Layout: MeshFileHeader, MeshVertexAttribute[AttributeCount], MeshSubmesh[SubmeshCount], then the vertex
+// and index data at the offsets in the header, 16 byte aligned. Little endian, no compression. Only plain
+// structs, so the importer can share it without pulling in Vulkan.
+
+constexpr uint32_t MeshFileMagic = 'V' | 'M' << 8 | 'S' << 16 | 'H' << 24;
+constexpr uint32_t MeshFileVersion = 1;
+constexpr uint64_t MeshFileDataAlignment = 16;
+
+enum class MeshAttributeSemantic : uint32_t
+{
+	Position = 0,
+	Color,
+	TextureCoord
+};
+
+enum class MeshAttributeFormat : uint32_t
+{
+	Float2 = 0,
+	Float3,
+	Float4
+};
+
+enum class MeshIndexType : uint32_t
+{
+	Uint16 = 0,
+	Uint32
+};
+
+struct MeshVertexAttribute
+{
+	MeshAttributeSemantic Semantic;
+	MeshAttributeFormat Format;
+	uint32_t Offset; // Within the vertex
+};
+
+// Range of the index data, indices are relative to the first vertex of the file
+struct MeshSubmesh
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+struct MeshFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t ContentHash; // FNV-1a of everything after the header, so the asset cache doesn't have to read the file
+
+	uint32_t VertexStride;
+	uint32_t AttributeCount;
+	uint32_t VertexCount;
+	MeshIndexType IndexType;
+	uint32_t IndexCount;
+	uint32_t SubmeshCount;
+
+	float BoundsMin[3];
+	float BoundsMax[3];
+
+	uint64_t VertexDataOffset;
+	uint64_t IndexDataOffset;
+};
+
+static_assert(sizeof(MeshFileHeader) == 80, "Mesh file header has to match the file layout");
+static_assert(sizeof(MeshSubmesh) == 32, "Mesh submesh has to match the file layout");
\ No newline at end of file
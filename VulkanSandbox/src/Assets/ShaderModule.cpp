@@ -0,0 +1,20 @@
+#include "ShaderModule.h"
+
+#include "../Application.h"
+
+ShaderModule::ShaderModule(const std::vector<char>& byteCode)
+	: m_size(byteCode.size())
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = byteCode.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(byteCode.data());
+
+	VK_CHECK(vkCreateShaderModule(Application::Get().GetDevice()->GetNativeDevice(), &createInfo, nullptr, &m_shaderModule), "Failed to create shader module!");
+}
+
+ShaderModule::~ShaderModule()
+{
+	// Pipelines don't need their modules once they are created
+	vkDestroyShaderModule(Application::Get().GetDevice()->GetNativeDevice(), m_shaderModule, nullptr);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Asset.h"
+
+class ShaderModule : public Asset
+{
+public:
+	ShaderModule(const std::vector<char>& byteCode);
+	~ShaderModule();
+
+	VkShaderModule GetNativeModule() const { return m_shaderModule; }
+
+	VkDeviceSize GetMemorySize() override { return m_size; }
+
+private:
+	VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+	VkDeviceSize m_size;
+};
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "StaticMesh.h"
+
+#include "MeshFormat.h"
+#include "../Application.h"
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Header values are untrusted, written so that nothing can wrap around
+static bool IsInFile(const MappedFile& file, uint64_t offset, uint64_t size)
+{
+	return offset <= file.GetSize() && size <= file.GetSize() - offset;
+}
+
+static const MeshFileHeader* GetHeader(const MappedFile& file)
+{
+	if (!file.IsValid() || file.GetSize() < sizeof(MeshFileHeader))
+		return nullptr;
+
+	const MeshFileHeader* header = (const MeshFileHeader*)file.GetData();
+	if (header->Magic != MeshFileMagic || header->Version != MeshFileVersion)
+		return nullptr;
+
+	return header;
+}
+
+StaticMesh::StaticMesh(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	m_mesh = Application::Get().GetGeometryPool()->Allocate(vertices, vertexCount, indices, indexCount);
+	m_submeshes.push_back(m_mesh);
+
+	if (vertexCount)
+		m_bounds = { vertices[0].Position, vertices[0].Position };
+
+	for (uint32_t i = 1; i < vertexCount; i++)
+	{
+		m_bounds.Min = glm::min(m_bounds.Min, vertices[i].Position);
+		m_bounds.Max = glm::max(m_bounds.Max, vertices[i].Position);
+	}
+}
+
+StaticMesh::StaticMesh(const MappedFile& file)
+{
+	PROFILE_SCOPE("StaticMesh::Load");
+
+	const MeshFileHeader* header = GetHeader(file);
+	if (!header)
+		throw std::runtime_error("Failed to load mesh, no mesh file!");
+
+	// Counts are 32 bit, so none of these products overflow 64 bits
+	uint64_t vertexSize = (uint64_t)header->VertexCount * header->VertexStride;
+	uint64_t indexSize = (uint64_t)header->IndexCount * sizeof(uint32_t);
+	uint64_t tableSize = (uint64_t)header->AttributeCount * sizeof(MeshVertexAttribute) + (uint64_t)header->SubmeshCount * sizeof(MeshSubmesh);
+
+	if (!IsInFile(file, sizeof(MeshFileHeader), tableSize) || !IsInFile(file, header->VertexDataOffset, vertexSize) || !IsInFile(file, header->IndexDataOffset, indexSize))
+		throw std::runtime_error("Failed to load mesh, the file is truncated!");
+
+	if (header->VertexDataOffset % alignof(Vertex) != 0 || header->IndexDataOffset % alignof(uint32_t) != 0)
+		throw std::runtime_error("Failed to load mesh, the data is misaligned!");
+
+	// The layout has to be the one the pipeline reads, the file is used as it is
+	const MeshVertexAttribute* attributes = (const MeshVertexAttribute*)(file.GetData() + sizeof(MeshFileHeader));
+	const MeshSubmesh* submeshes = (const MeshSubmesh*)(attributes + header->AttributeCount);
+
+	const MeshVertexAttribute expectedAttributes[] = {
+		{ MeshAttributeSemantic::Position, MeshAttributeFormat::Float3, (uint32_t)offsetof(Vertex, Position) },
+		{ MeshAttributeSemantic::Color, MeshAttributeFormat::Float3, (uint32_t)offsetof(Vertex, Color) },
+		{ MeshAttributeSemantic::TextureCoord, MeshAttributeFormat::Float2, (uint32_t)offsetof(Vertex, TextureCoord) }
+	};
+
+	bool layoutMatches = header->VertexStride == sizeof(Vertex) && header->AttributeCount == 3 && header->IndexType == MeshIndexType::Uint32;
+	for (uint32_t i = 0; layoutMatches && i < header->AttributeCount; i++)
+		layoutMatches = memcmp(&attributes[i], &expectedAttributes[i], sizeof(MeshVertexAttribute)) == 0;
+
+	if (!layoutMatches)
+		throw std::runtime_error("Failed to load mesh, the vertex layout or index type doesn't match the pipeline!");
+
+	if (header->IndexCount % 3 != 0)
+		throw std::runtime_error("Failed to load mesh, the indices don't make up whole triangles!");
+
+	for (uint32_t i = 0; i < header->SubmeshCount; i++)
+	{
+		if ((uint64_t)submeshes[i].FirstIndex + submeshes[i].IndexCount > header->IndexCount)
+			throw std::runtime_error("Failed to load mesh, a submesh is out of range!");
+	}
+
+	// Straight from the mapping into staging memory, the pages are read in as they are copied
+	const Vertex* vertices = (const Vertex*)(file.GetData() + header->VertexDataOffset);
+	const uint32_t* indices = (const uint32_t*)(file.GetData() + header->IndexDataOffset);
+
+	// An index past the vertices would have the GPU read another mesh's vertices out of the pool. This pass
+	// pulls the index pages in ahead of the copy, so it costs little on top of it.
+	{
+		PROFILE_SCOPE("StaticMesh::ValidateIndices");
+
+		uint32_t maxIndex = 0;
+		for (uint32_t i = 0; i < header->IndexCount; i++)
+			maxIndex = std::max(maxIndex, indices[i]);
+
+		if (header->IndexCount > 0 && maxIndex >= header->VertexCount)
+			throw std::runtime_error("Failed to load mesh, an index is out of range!");
+	}
+
+	m_mesh = Application::Get().GetGeometryPool()->Allocate(vertices, header->VertexCount, indices, header->IndexCount);
+	m_bounds = { glm::vec3(header->BoundsMin[0], header->BoundsMin[1], header->BoundsMin[2]), glm::vec3(header->BoundsMax[0], header->BoundsMax[1], header->BoundsMax[2]) };
+
+	for (uint32_t i = 0; i < header->SubmeshCount; i++)
+	{
+		Mesh submesh = m_mesh;
+		submesh.FirstIndex += submeshes[i].FirstIndex;
+		submesh.IndexCount = submeshes[i].IndexCount;
+		m_submeshes.push_back(submesh);
+	}
+}
+
+StaticMesh::~StaticMesh()
+{
+	Application::Get().GetGeometryPool()->Free(m_mesh);
+}
+
+VkDeviceSize StaticMesh::GetMemorySize()
+{
+	return (VkDeviceSize)m_mesh.VertexCount * sizeof(Vertex) + (VkDeviceSize)m_mesh.IndexCount * sizeof(uint32_t);
+}
+
+uint64_t StaticMesh::GetContentHash(const MappedFile& file)
+{
+	const MeshFileHeader* header = GetHeader(file);
+
+	return header ? header->ContentHash : 0;
+}
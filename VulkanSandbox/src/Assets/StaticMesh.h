@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Asset.h"
+#include "../Buffer/GeometryPool.h"
+#include "../Memory/MappedFile.h"
+
+struct Bounds
+{
+	glm::vec3 Min{ 0.0f };
+	glm::vec3 Max{ 0.0f };
+};
+
+// Range of the geometry pool that is returned to it when the mesh goes away. Submeshes are parts of that
+// range, the whole mesh draws all of them at once.
+class StaticMesh : public Asset
+{
+public:
+	StaticMesh(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	// A .vmesh file (see MeshFormat.h), vertices and indices are copied from the mapping into staging memory
+	StaticMesh(const MappedFile& file);
+	~StaticMesh();
+
+	const Mesh& GetMesh() const { return m_mesh; }
+	const std::vector<Mesh>& GetSubmeshes() const { return m_submeshes; }
+	const Bounds& GetBounds() const { return m_bounds; }
+
+	VkDeviceSize GetMemorySize() override;
+
+	// 0 when the file is no mesh file
+	static uint64_t GetContentHash(const MappedFile& file);
+
+private:
+	Mesh m_mesh;
+	std::vector<Mesh> m_submeshes;
+	Bounds m_bounds;
+};
\ No newline at end of file
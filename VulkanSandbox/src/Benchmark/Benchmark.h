@@ -0,0 +1,5 @@
+#pragma once
+
+// Microbenchmarks that run without a window or device, see main.cpp for the command line
+void RunRenderCommandQueueBenchmark();
+void RunJobSystemBenchmark();
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "FrameBenchmark.h"
+
+#include "Memory/Allocator.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+static void WriteStats(std::ostream& stream, const FrameTimeStats& stats)
+{
+	stream << "{ \"Count\": " << stats.Count << ", \"AvgMs\": " << stats.AvgMs << ", \"MinMs\": " << stats.MinMs;
+	stream << ", \"P50Ms\": " << stats.P50Ms << ", \"P90Ms\": " << stats.P90Ms << ", \"P99Ms\": " << stats.P99Ms << ", \"MaxMs\": " << stats.MaxMs << " }";
+}
+
+FrameBenchmark::FrameBenchmark(uint32_t warmupFrames)
+	: m_warmupFrames(warmupFrames)
+{
+}
+
+void FrameBenchmark::AddMainFrame(uint64_t frameNumber, double ms)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (frameNumber < m_warmupFrames)
+		return;
+
+	// The measured part of the run starts with the first frame after the warmup
+	if (m_mainMs.empty())
+	{
+		m_startTime = std::chrono::high_resolution_clock::now();
+		m_startAllocationCount = Allocator::GetStats().AllocationCount;
+	}
+
+	m_mainMs.push_back(ms);
+}
+
+void FrameBenchmark::AddRenderFrame(uint64_t frameNumber, double ms)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (frameNumber >= m_warmupFrames)
+		m_renderMs.push_back(ms);
+}
+
+void FrameBenchmark::WriteReport(const std::filesystem::path& filepath, const std::string& settings, const std::unordered_map<std::string, std::vector<double>>& gpuSamples)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Nothing past the warmup means no start time either, the report gets zeros rather than time since the epoch
+	double seconds = m_mainMs.empty() ? 0.0 : std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_startTime).count();
+	uint64_t allocations = m_mainMs.empty() ? 0 : Allocator::GetStats().AllocationCount - m_startAllocationCount;
+
+	FrameTimeStats mainStats = CalculateStats(m_mainMs);
+	FrameTimeStats renderStats = CalculateStats(m_renderMs);
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(4);
+
+	ss << "{\n";
+	ss << "\"Settings\": " << settings << ",\n";
+	ss << "\"MeasuredFrames\": " << m_mainMs.size() << ",\n";
+	ss << "\"Seconds\": " << seconds << ",\n";
+	ss << "\"FramesPerSecond\": " << (seconds > 0.0 ? m_mainMs.size() / seconds : 0.0) << ",\n";
+	ss << "\"GpuAllocations\": " << allocations << ",\n";
+
+	ss << "\"Cpu\": {\n";
+	ss << "\t\"Main\": ";
+	WriteStats(ss, mainStats);
+	ss << ",\n\t\"Render\": ";
+	WriteStats(ss, renderStats);
+	ss << "\n},\n";
+
+	// Sorted, so reports of different runs diff cleanly
+	std::vector<std::string> zones;
+	for (const auto& [name, samples] : gpuSamples)
+		zones.push_back(name);
+	std::sort(zones.begin(), zones.end());
+
+	ss << "\"Gpu\": {";
+	for (size_t i = 0; i < zones.size(); i++)
+	{
+		ss << (i ? "," : "") << "\n\t\"" << zones[i] << "\": ";
+		WriteStats(ss, CalculateStats(gpuSamples.at(zones[i])));
+	}
+	ss << "\n},\n";
+
+	ss << "\"Memory\": " << Allocator::GetStatsJson();
+	ss << "}\n";
+
+	std::ofstream file(filepath);
+	if (!file)
+	{
+		LOG("Failed to open " << filepath << " for writing!");
+		return;
+	}
+
+	file << ss.str();
+
+	std::stringstream summary;
+	summary << std::fixed << std::setprecision(2);
+	summary << "[Benchmark] " << m_mainMs.size() << " frames in " << seconds << " s, main p50 " << mainStats.P50Ms << " ms p99 " << mainStats.P99Ms;
+	summary << " ms, render p50 " << renderStats.P50Ms << " ms p99 " << renderStats.P99Ms << " ms, written to " << filepath;
+	LOG(summary.str());
+}
+
+FrameTimeStats FrameBenchmark::CalculateStats(std::vector<double> samples)
+{
+	FrameTimeStats stats;
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	// Nearest rank, the smallest sample with at least p of all samples at or below it
+	auto percentile = [&](double p)
+	{
+		size_t rank = (size_t)std::ceil(p * samples.size());
+		return samples[std::max<size_t>(rank, 1) - 1];
+	};
+
+	stats.Count = (uint32_t)samples.size();
+	stats.MinMs = samples.front();
+	stats.MaxMs = samples.back();
+	stats.P50Ms = percentile(0.50);
+	stats.P90Ms = percentile(0.90);
+	stats.P99Ms = percentile(0.99);
+
+	for (double sample : samples)
+		stats.AvgMs += sample;
+	stats.AvgMs /= samples.size();
+
+	return stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FrameTimeStats
+{
+	uint32_t Count = 0;
+	double AvgMs = 0.0;
+	double MinMs = 0.0;
+	double P50Ms = 0.0;
+	double P90Ms = 0.0;
+	double P99Ms = 0.0;
+	double MaxMs = 0.0;
+};
+
+// Per frame samples of a benchmark run (--benchmark), written out as JSON at the end. Frames before
+// warmupFrames are left out, they are dominated by pipeline and upload warmup.
+class FrameBenchmark
+{
+public:
+	FrameBenchmark(uint32_t warmupFrames);
+
+	// Any thread
+	void AddMainFrame(uint64_t frameNumber, double ms);
+	void AddRenderFrame(uint64_t frameNumber, double ms);
+
+	// Settings is a JSON object describing the run, gpuSamples the per zone samples of the GPU profiler
+	void WriteReport(const std::filesystem::path& filepath, const std::string& settings, const std::unordered_map<std::string, std::vector<double>>& gpuSamples);
+
+	static FrameTimeStats CalculateStats(std::vector<double> samples);
+
+private:
+	uint32_t m_warmupFrames;
+
+	std::vector<double> m_mainMs;
+	std::vector<double> m_renderMs;
+
+	std::chrono::high_resolution_clock::time_point m_startTime;
+	uint64_t m_startAllocationCount = 0;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
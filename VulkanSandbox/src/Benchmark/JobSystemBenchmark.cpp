@@ -0,0 +1,66 @@
+#include "Benchmark.h"
+
+#include "Jobs/JobSystem.h"
+#include "Vulkan.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+static constexpr uint32_t s_objectCount = 1024 * 1024;
+static constexpr uint32_t s_batchSize = 1024;
+static constexpr uint32_t s_runs = 20;
+
+// Roughly the per object work of a transform update: compose a model matrix and its MVP
+static void UpdateTransforms(std::vector<glm::mat4>& transforms, float time)
+{
+	glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	JobSystem::ParallelFor((uint32_t)transforms.size(), s_batchSize, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 1024), (float)(i / 1024), 0.0f));
+			model = glm::rotate(model, time + i * 0.001f, glm::vec3(0.0f, 0.0f, 1.0f));
+			model = glm::scale(model, glm::vec3(0.5f));
+
+			transforms[i] = viewProjection * model;
+		}
+	});
+}
+
+void RunJobSystemBenchmark()
+{
+	uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	LOG("JobSystem benchmark: " << s_runs << " transform updates of " << s_objectCount << " objects, batches of " << s_batchSize);
+
+	std::vector<glm::mat4> transforms(s_objectCount);
+	double singleThreadMs = 0.0;
+
+	for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount++)
+	{
+		// The calling thread takes part, so one thread means no workers at all
+		if (threadCount > 1)
+			JobSystem::Init(threadCount - 1);
+
+		UpdateTransforms(transforms, 0.0f); // Warm up
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t run = 0; run < s_runs; run++)
+			UpdateTransforms(transforms, (float)run);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		if (threadCount > 1)
+			JobSystem::Shutdown();
+
+		double ms = std::chrono::duration<double, std::milli>(end - start).count() / s_runs;
+		if (threadCount == 1)
+			singleThreadMs = ms;
+
+		double speedup = singleThreadMs / ms;
+		LOG("  " << threadCount << " threads: " << ms << " ms/update, " << speedup << "x (" << speedup / threadCount * 100.0 << "% efficiency)");
+	}
+}
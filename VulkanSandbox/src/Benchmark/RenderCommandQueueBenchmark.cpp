@@ -0,0 +1,107 @@
+#include "Benchmark.h"
+
+#include "Memory/RenderCommandQueue.h"
+#include "Vulkan.h"
+
+#include <chrono>
+#include <functional>
+#include <queue>
+
+// The std::function based queue RenderCommandQueue replaced, kept here for comparison
+class FunctionCommandQueue
+{
+public:
+	void AddCommand(std::function<void()> fn)
+	{
+		m_commandQueue.push(fn);
+		m_commandCount++;
+	}
+
+	void Execute()
+	{
+		for (uint32_t i = 0; i < m_commandCount; i++)
+		{
+			m_commandQueue.front()();
+			m_commandQueue.pop();
+		}
+
+		m_commandCount = 0;
+	}
+
+private:
+	std::queue<std::function<void()>> m_commandQueue;
+	uint32_t m_commandCount = 0;
+};
+
+// Roughly what a draw command captures: a few handles, offsets and counts
+struct DrawData
+{
+	uint64_t Pipeline;
+	uint64_t DescriptorSet;
+	uint32_t VertexOffset;
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	uint32_t UniformOffset;
+	float Transform[4];
+};
+
+static constexpr uint32_t s_frames = 200;
+static constexpr uint32_t s_commandsPerFrame = 50000;
+
+static volatile uint64_t s_sink = 0;
+
+template<typename Fn>
+static double Measure(Fn&& fn)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	fn();
+	auto end = std::chrono::high_resolution_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+void RunRenderCommandQueueBenchmark()
+{
+	LOG("RenderCommandQueue benchmark: " << s_frames << " frames of " << s_commandsPerFrame << " commands, " << sizeof(DrawData) << " bytes captured each");
+
+	FunctionCommandQueue functionQueue;
+
+	double functionTime = Measure([&]()
+	{
+		for (uint32_t frame = 0; frame < s_frames; frame++)
+		{
+			for (uint32_t i = 0; i < s_commandsPerFrame; i++)
+			{
+				DrawData data{ i, frame, i, i * 3, 36, i * 256 };
+				functionQueue.AddCommand([data]() { s_sink = s_sink + data.IndexCount + data.FirstIndex; });
+			}
+
+			functionQueue.Execute();
+		}
+	});
+
+	// Warm up the arena pages
+	for (uint32_t i = 0; i < s_commandsPerFrame; i++)
+		RenderCommandQueue::Submit([]() {});
+	RenderCommandQueue::SwapQueues();
+	RenderCommandQueue::Execute();
+
+	double arenaTime = Measure([&]()
+	{
+		for (uint32_t frame = 0; frame < s_frames; frame++)
+		{
+			for (uint32_t i = 0; i < s_commandsPerFrame; i++)
+			{
+				DrawData data{ i, frame, i, i * 3, 36, i * 256 };
+				RenderCommandQueue::Submit([data]() { s_sink = s_sink + data.IndexCount + data.FirstIndex; });
+			}
+
+			RenderCommandQueue::SwapQueues();
+			RenderCommandQueue::Execute();
+		}
+	});
+
+	double commandCount = (double)s_frames * s_commandsPerFrame;
+	LOG("  std::function queue: " << functionTime / commandCount << " ns/command");
+	LOG("  Arena queue:         " << arenaTime / commandCount << " ns/command (" << functionTime / arenaTime << "x)");
+}
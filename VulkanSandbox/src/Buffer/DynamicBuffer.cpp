@@ -0,0 +1,82 @@
+#include "DynamicBuffer.h"
+
+#include "../Application.h"
+#include "../Memory/DeletionCommandQueue.h"
+
+#include <algorithm>
+
+static uint32_t GetCurrentFrameIndex()
+{
+	return Application::Get().GetRenderTarget()->GetCurrentFrameIndex();
+}
+
+DynamicBuffer::DynamicBuffer(uint32_t size, VkBufferUsageFlags usage)
+	: m_usage(usage)
+{
+	m_buffers.resize(VulkanConfig::MaxFramesInFlight);
+	m_allocations.resize(VulkanConfig::MaxFramesInFlight);
+	m_memoryMaps.resize(VulkanConfig::MaxFramesInFlight);
+	m_sizes.resize(VulkanConfig::MaxFramesInFlight);
+
+	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
+		CreateRegion(i, size);
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+	// Frames in flight may still be reading from their regions
+	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
+		DeletionCommandQueue::DestroyBuffer(m_buffers[i], m_allocations[i]);
+}
+
+void DynamicBuffer::SetData(const void* data, uint32_t size)
+{
+	uint32_t frameIndex = GetCurrentFrameIndex();
+
+	// The region of this frame is no longer in use by the GPU, so it can be replaced right away
+	if (size > m_sizes[frameIndex])
+	{
+		uint32_t newSize = std::max(size, m_sizes[frameIndex] + m_sizes[frameIndex] / 2);
+
+		DestroyRegion(frameIndex);
+		CreateRegion(frameIndex, newSize);
+	}
+
+	memcpy(m_memoryMaps[frameIndex], data, (size_t)size);
+	Allocator::FlushMemory(m_allocations[frameIndex], 0, size);
+}
+
+VkBuffer DynamicBuffer::GetBuffer() const
+{
+	return m_buffers[GetCurrentFrameIndex()];
+}
+
+uint32_t DynamicBuffer::GetSize() const
+{
+	return m_sizes[GetCurrentFrameIndex()];
+}
+
+void DynamicBuffer::CreateRegion(uint32_t frameIndex, uint32_t size)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = m_usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	AllocationCategory category = (m_usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) ? AllocationCategory::Vertex : AllocationCategory::Index;
+
+	// Lets VMA pick device local host visible memory (resizable BAR) when there is any
+	m_allocations[frameIndex] = Allocator::AllocateBuffer(m_buffers[frameIndex], bufferInfo, category, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	m_memoryMaps[frameIndex] = Allocator::GetMappedData(m_allocations[frameIndex]);
+	m_sizes[frameIndex] = size;
+}
+
+void DynamicBuffer::DestroyRegion(uint32_t frameIndex)
+{
+	Allocator::DestroyBuffer(m_buffers[frameIndex], m_allocations[frameIndex]);
+
+	m_buffers[frameIndex] = VK_NULL_HANDLE;
+	m_memoryMaps[frameIndex] = nullptr;
+	m_sizes[frameIndex] = 0;
+}
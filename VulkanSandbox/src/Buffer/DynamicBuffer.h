@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../Memory/Allocator.h"
+
+#include <vector>
+
+// Host visible, persistently mapped buffer with one region per frame in flight. SetData() writes
+// straight into the region of the current frame, which the GPU is done with after
+// Swapchain::BeginFrame(), so it never has to wait. Regions grow when the data outgrows them.
+class DynamicBuffer
+{
+public:
+	DynamicBuffer(uint32_t size, VkBufferUsageFlags usage);
+	~DynamicBuffer();
+
+	void SetData(const void* data, uint32_t size);
+
+	VkBuffer GetBuffer() const;
+	uint32_t GetSize() const;
+
+private:
+	void CreateRegion(uint32_t frameIndex, uint32_t size);
+	void DestroyRegion(uint32_t frameIndex);
+
+private:
+	VkBufferUsageFlags m_usage;
+
+	std::vector<VkBuffer> m_buffers;
+	std::vector<VmaAllocation> m_allocations;
+	std::vector<void*> m_memoryMaps;
+	std::vector<uint32_t> m_sizes;
+};
\ No newline at end of file
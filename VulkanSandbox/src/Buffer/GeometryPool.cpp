@@ -0,0 +1,178 @@
+#include "GeometryPool.h"
+
+#include "../Application.h"
+#include "../Memory/DeletionCommandQueue.h"
+
+#include <algorithm>
+
+GeometryPool::GeometryPool(const std::shared_ptr<LogicalDevice>& device, uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_logicalDevice(device)
+{
+	m_vertexBuffer = CreateBuffer(m_vertexAllocation, (VkDeviceSize)vertexCapacity * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, AllocationCategory::Vertex);
+	m_indexBuffer = CreateBuffer(m_indexAllocation, (VkDeviceSize)indexCapacity * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, AllocationCategory::Index);
+
+	// The blocks count in vertices and indices, so offsets can be used for drawing as they are
+	VmaVirtualBlockCreateInfo blockInfo{};
+	blockInfo.size = vertexCapacity;
+	VK_CHECK(vmaCreateVirtualBlock(&blockInfo, &m_vertexBlock), "Failed to create vertex pool!");
+
+	blockInfo.size = indexCapacity;
+	VK_CHECK(vmaCreateVirtualBlock(&blockInfo, &m_indexBlock), "Failed to create index pool!");
+}
+
+GeometryPool::~GeometryPool()
+{
+	// Can't pull the buffers out from under a copy that is still in flight
+	Application::Get().GetUploadContext()->Wait(m_uploadTicket);
+
+	vmaClearVirtualBlock(m_vertexBlock);
+	vmaClearVirtualBlock(m_indexBlock);
+	vmaDestroyVirtualBlock(m_vertexBlock);
+	vmaDestroyVirtualBlock(m_indexBlock);
+
+	DeletionCommandQueue::DestroyBuffer(m_vertexBuffer, m_vertexAllocation);
+	DeletionCommandQueue::DestroyBuffer(m_indexBuffer, m_indexAllocation);
+}
+
+Mesh GeometryPool::Allocate(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	Mesh mesh;
+	mesh.VertexCount = vertexCount;
+	mesh.IndexCount = indexCount;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		VmaVirtualAllocationCreateInfo allocationInfo{};
+		VkDeviceSize offset;
+
+		allocationInfo.size = vertexCount;
+		if (vmaVirtualAllocate(m_vertexBlock, &allocationInfo, &mesh.VertexAllocation, &offset) != VK_SUCCESS)
+			throw std::runtime_error("Geometry pool is out of vertex space, raise VulkanConfig::GeometryPoolVertexCount!");
+		mesh.VertexOffset = (int32_t)offset;
+
+		allocationInfo.size = indexCount;
+		if (vmaVirtualAllocate(m_indexBlock, &allocationInfo, &mesh.IndexAllocation, &offset) != VK_SUCCESS)
+		{
+			vmaVirtualFree(m_vertexBlock, mesh.VertexAllocation);
+			throw std::runtime_error("Geometry pool is out of index space, raise VulkanConfig::GeometryPoolIndexCount!");
+		}
+		mesh.FirstIndex = (uint32_t)offset;
+	}
+
+	VkDeviceSize vertexSize = (VkDeviceSize)vertexCount * sizeof(Vertex);
+	VkDeviceSize indexSize = (VkDeviceSize)indexCount * sizeof(uint32_t);
+
+	StagingAllocation vertexStaging = Allocator::AllocateStaging(vertices, vertexSize);
+	StagingAllocation indexStaging = Allocator::AllocateStaging(indices, indexSize);
+
+	auto& uploadContext = Application::Get().GetUploadContext();
+	uploadContext->Record([&](VkCommandBuffer commandBuffer)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = vertexStaging.Offset;
+		copyRegion.dstOffset = (VkDeviceSize)mesh.VertexOffset * sizeof(Vertex);
+		copyRegion.size = vertexSize;
+		vkCmdCopyBuffer(commandBuffer, vertexStaging.Buffer, m_vertexBuffer, 1, &copyRegion);
+
+		copyRegion.srcOffset = indexStaging.Offset;
+		copyRegion.dstOffset = (VkDeviceSize)mesh.FirstIndex * sizeof(uint32_t);
+		copyRegion.size = indexSize;
+		vkCmdCopyBuffer(commandBuffer, indexStaging.Buffer, m_indexBuffer, 1, &copyRegion);
+	});
+
+	// The buffers are shared between the queue families, so there is no ownership to hand over
+	UploadTicket ticket = uploadContext->RecordGraphics([&](VkCommandBuffer commandBuffer)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	});
+
+	uploadContext->ReleaseOnComplete(vertexStaging);
+	uploadContext->ReleaseOnComplete(indexStaging);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_uploadTicket = std::max(m_uploadTicket, ticket);
+	}
+
+	return mesh;
+}
+
+void GeometryPool::Free(const Mesh& mesh)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pendingFrees.push_back({ mesh, m_frame });
+}
+
+void GeometryPool::Update()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_frame++;
+
+	// Frames recorded before the free could still be drawing from the range
+	while (!m_pendingFrees.empty() && m_pendingFrees.front().Frame + VulkanConfig::MaxFramesInFlight <= m_frame)
+	{
+		const Mesh& mesh = m_pendingFrees.front().Range;
+		vmaVirtualFree(m_vertexBlock, mesh.VertexAllocation);
+		vmaVirtualFree(m_indexBlock, mesh.IndexAllocation);
+
+		m_pendingFrees.pop_front();
+	}
+}
+
+void GeometryPool::Bind(VkCommandBuffer commandBuffer)
+{
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::Draw(VkCommandBuffer commandBuffer, const Mesh& mesh, uint32_t instanceCount, uint32_t firstInstance)
+{
+	vkCmdDrawIndexed(commandBuffer, mesh.IndexCount, instanceCount, mesh.FirstIndex, mesh.VertexOffset, firstInstance);
+}
+
+VkDrawIndexedIndirectCommand GeometryPool::GetDrawCommand(const Mesh& mesh, uint32_t instanceCount, uint32_t firstInstance) const
+{
+	VkDrawIndexedIndirectCommand command{};
+	command.indexCount = mesh.IndexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = mesh.FirstIndex;
+	command.vertexOffset = mesh.VertexOffset;
+	command.firstInstance = firstInstance;
+
+	return command;
+}
+
+VkBuffer GeometryPool::CreateBuffer(VmaAllocation& allocation, VkDeviceSize size, VkBufferUsageFlags usage, AllocationCategory category)
+{
+	const QueueFamilyIndices& indices = m_logicalDevice->GetPhysicalDevice()->GetQueueFamilyIndices();
+	uint32_t queueFamilies[] = { (uint32_t)indices.Graphics, (uint32_t)indices.Transfer };
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+
+	// Uploads write parts of the buffers on the transfer queue while the rest is being drawn from
+	if (indices.HasDedicatedTransfer())
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	} else
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	VkBuffer buffer;
+	allocation = Allocator::AllocateBuffer(buffer, bufferInfo, category, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	return buffer;
+}
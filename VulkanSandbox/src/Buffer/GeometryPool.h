@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../Device/UploadContext.h"
+#include "../Memory/Allocator.h"
+#include "../Vertex.h"
+
+#include <deque>
+#include <mutex>
+
+// A range of the geometry pool, draw it with the pool bound
+struct Mesh
+{
+	int32_t VertexOffset = 0;
+	uint32_t VertexCount = 0;
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+
+	VmaVirtualAllocation VertexAllocation = VK_NULL_HANDLE;
+	VmaVirtualAllocation IndexAllocation = VK_NULL_HANDLE;
+};
+
+// One device local vertex buffer and one index buffer that all static meshes are sub-allocated from
+// (VMA virtual blocks, TLSF). A whole scene can be drawn with a single bind, and a mesh maps straight
+// onto a VkDrawIndexedIndirectCommand.
+class GeometryPool
+{
+public:
+	GeometryPool(const std::shared_ptr<LogicalDevice>& device, uint32_t vertexCapacity = VulkanConfig::GeometryPoolVertexCount, uint32_t indexCapacity = VulkanConfig::GeometryPoolIndexCount);
+	~GeometryPool();
+
+	// Indices are relative to the first vertex of the mesh. Safe to call from multiple threads.
+	Mesh Allocate(const Vertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	// The ranges are reused once the frames in flight are done with them
+	void Free(const Mesh& mesh);
+
+	// Call once per frame, after the fence of the frame has been waited on
+	void Update();
+
+	void Bind(VkCommandBuffer commandBuffer);
+	void Draw(VkCommandBuffer commandBuffer, const Mesh& mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+	VkDrawIndexedIndirectCommand GetDrawCommand(const Mesh& mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+	VkBuffer GetVertexBuffer() const { return m_vertexBuffer; }
+	VkBuffer GetIndexBuffer() const { return m_indexBuffer; }
+
+private:
+	VkBuffer CreateBuffer(VmaAllocation& allocation, VkDeviceSize size, VkBufferUsageFlags usage, AllocationCategory category);
+
+private:
+	std::shared_ptr<LogicalDevice> m_logicalDevice;
+
+	VkBuffer m_vertexBuffer;
+	VmaAllocation m_vertexAllocation;
+	VmaVirtualBlock m_vertexBlock;
+
+	VkBuffer m_indexBuffer;
+	VmaAllocation m_indexAllocation;
+	VmaVirtualBlock m_indexBlock;
+
+	struct PendingFree
+	{
+		Mesh Range;
+		uint64_t Frame;
+	};
+
+	std::deque<PendingFree> m_pendingFrees;
+	uint64_t m_frame = 0;
+
+	UploadTicket m_uploadTicket = 0;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
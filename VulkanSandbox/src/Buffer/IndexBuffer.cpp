@@ -1,45 +1,65 @@
 #include "IndexBuffer.h"
 
 #include "../Application.h"
+#include "../Memory/DeletionCommandQueue.h"
 
 IndexBuffer::IndexBuffer(void* data, uint32_t size)
 	: m_size(size)
 {
-	VkBufferCreateInfo stagingBufferInfo{};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.size = size;
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	stagingBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	VkBuffer stagingBuffer;
-	VmaAllocation stagingBufferAlloc = Allocator::AllocateBuffer(stagingBuffer, stagingBufferInfo, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	void* memData = Allocator::MapMemory(stagingBufferAlloc);
-	memcpy(memData, data, (size_t)size);
-	Allocator::UnmapMemory(stagingBufferAlloc);
+	StagingAllocation staging = Allocator::AllocateStaging(data, size);
 
 	VkBufferCreateInfo indexBufferInfo{};
 	indexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	indexBufferInfo.size = size;
-	indexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+	indexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 	indexBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	m_allocation = Allocator::AllocateBuffer(m_buffer, indexBufferInfo, VMA_MEMORY_USAGE_GPU_ONLY);
+	m_allocation = Allocator::AllocateBuffer(m_buffer, indexBufferInfo, AllocationCategory::Index, VMA_MEMORY_USAGE_GPU_ONLY);
 
-	auto& device = Application::Get().GetDevice();
-	VkCommandBuffer commandBuffer = device->GetCommandBuffer(true);
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
+	auto& uploadContext = Application::Get().GetUploadContext();
+	uploadContext->Record([&](VkCommandBuffer commandBuffer)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = staging.Offset;
+		copyRegion.dstOffset = 0;
+		copyRegion.size = size;
 
-	vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_buffer, 1, &copyRegion);
-	device->FlushCommandBuffer(commandBuffer);
+		vkCmdCopyBuffer(commandBuffer, staging.Buffer, m_buffer, 1, &copyRegion);
+	});
 
-	Allocator::DestroyBuffer(stagingBuffer, stagingBufferAlloc);
+	m_uploadTicket = uploadContext->ReleaseBufferToGraphics(m_buffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	uploadContext->ReleaseOnComplete(staging);
+
+	Allocator::RegisterMovable(m_allocation, &m_buffer, indexBufferInfo, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
+IndexBuffer::IndexBuffer(uint32_t size)
+	: m_size(size)
+{
+	m_dynamicBuffer = std::make_unique<DynamicBuffer>(size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 }
 
 IndexBuffer::~IndexBuffer()
 {
-	Allocator::DestroyBuffer(m_buffer, m_allocation);
+	if (m_dynamicBuffer)
+		return;
+
+	// Can't pull the buffer out from under a copy that is still in flight
+	Application::Get().GetUploadContext()->Wait(m_uploadTicket);
+
+	// Frames in flight may still be drawing with it
+	Allocator::UnregisterMovable(m_allocation);
+	DeletionCommandQueue::DestroyBuffer(m_buffer, m_allocation);
+}
+
+void IndexBuffer::SetData(void* data, uint32_t size)
+{
+	if (!m_dynamicBuffer)
+	{
+		LOG("SetData() called on a static index buffer!");
+		return;
+	}
+
+	m_dynamicBuffer->SetData(data, size);
+	m_size = size;
 }
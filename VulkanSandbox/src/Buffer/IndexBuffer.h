@@ -1,18 +1,31 @@
 #pragma once
 
+#include "DynamicBuffer.h"
+#include "../Device/UploadContext.h"
 #include "../Memory/Allocator.h"
 
 class IndexBuffer
 {
 public:
+	// Static, device local buffer
 	IndexBuffer(void* data, uint32_t size);
+	// Dynamic buffer, fill it every frame with SetData()
+	IndexBuffer(uint32_t size);
 	~IndexBuffer();
 
-	VkBuffer GetBuffer() const { return m_buffer; }
+	void SetData(void* data, uint32_t size);
+
+	VkBuffer GetBuffer() const { return m_dynamicBuffer ? m_dynamicBuffer->GetBuffer() : m_buffer; }
+	bool IsDynamic() const { return m_dynamicBuffer != nullptr; }
+	UploadTicket GetUploadTicket() const { return m_uploadTicket; }
 
 private:
 	uint32_t m_size;
 
-	VkBuffer m_buffer;
-	VmaAllocation m_allocation;
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+	VmaAllocation m_allocation = VK_NULL_HANDLE;
+
+	std::unique_ptr<DynamicBuffer> m_dynamicBuffer;
+
+	UploadTicket m_uploadTicket = 0;
 };
\ No newline at end of file
@@ -1,29 +1,54 @@
 #include "UniformBuffer.h"
 
-UniformBuffer::UniformBuffer(const std::shared_ptr<LogicalDevice>& device)
+#include "../Memory/DeletionCommandQueue.h"
+
+#include <algorithm>
+
+UniformBuffer::UniformBuffer(const std::shared_ptr<LogicalDevice>& device, uint32_t sizePerFrame)
 	: m_logicalDevice(device)
 {
-	VkDeviceSize size = sizeof(UniformBufferObject);
-
-	m_buffers.resize(VulkanConfig::MaxFramesInFlight);
-	m_allocations.resize(VulkanConfig::MaxFramesInFlight);
-	m_memoryMaps.resize(VulkanConfig::MaxFramesInFlight);
+	m_alignment = (uint32_t)m_logicalDevice->GetPhysicalDevice()->GetDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	m_sizePerFrame = (sizePerFrame + m_alignment - 1) & ~(m_alignment - 1);
 
 	VkBufferCreateInfo uboInfo{};
 	uboInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	uboInfo.size = size;
+	uboInfo.size = (VkDeviceSize)m_sizePerFrame * VulkanConfig::MaxFramesInFlight;
 	uboInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 	uboInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	for (size_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
-	{
-		m_allocations[i] = Allocator::AllocateBuffer(m_buffers[i], uboInfo, VMA_MEMORY_USAGE_CPU_ONLY);
-		m_memoryMaps[i] = Allocator::MapMemory(m_allocations[i]);
-	}
+	m_allocation = Allocator::AllocateBuffer(m_buffer, uboInfo, AllocationCategory::Uniform, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	m_data = (uint8_t*)Allocator::GetMappedData(m_allocation);
 }
 
 UniformBuffer::~UniformBuffer()
 {
-	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
-		Allocator::DestroyBuffer(m_buffers[i], m_allocations[i]);	
+	DeletionCommandQueue::DestroyBuffer(m_buffer, m_allocation);
+}
+
+void UniformBuffer::Reset(uint32_t frameIndex)
+{
+	m_frameOffset = frameIndex * m_sizePerFrame;
+	m_head = 0;
+}
+
+void UniformBuffer::Flush()
+{
+	uint32_t used = std::min((uint32_t)m_head, m_sizePerFrame);
+	if (used > 0)
+		Allocator::FlushMemory(m_allocation, m_frameOffset, used);
+}
+
+UniformAllocation UniformBuffer::Allocate(uint32_t size)
+{
+	uint32_t alignedSize = (size + m_alignment - 1) & ~(m_alignment - 1);
+	uint32_t offset = m_head.fetch_add(alignedSize);
+
+	if (offset + alignedSize > m_sizePerFrame)
+		throw std::runtime_error("Per-frame uniform buffer is full, raise VulkanConfig::UniformBufferSizePerFrame!");
+
+	UniformAllocation allocation;
+	allocation.Data = m_data + m_frameOffset + offset;
+	allocation.Offset = m_frameOffset + offset;
+
+	return allocation;
 }
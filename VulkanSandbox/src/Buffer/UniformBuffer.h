@@ -3,6 +3,8 @@
 #include "../Memory/Allocator.h"
 #include "../Device/LogicalDevice.h"
 
+#include <atomic>
+
 struct UniformBufferObject
 {
 	glm::mat4 Model;
@@ -10,21 +12,50 @@ struct UniformBufferObject
 	glm::mat4 Projection;
 };
 
+struct UniformAllocation
+{
+	void* Data;
+	uint32_t Offset; // Dynamic offset to bind the allocation with
+};
+
+// One large mapped uniform buffer with a region per frame in flight. Allocations bump an offset
+// through the region of the current frame and are bound as dynamic offset of a
+// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor, so any number of objects share one descriptor set.
 class UniformBuffer
 {
 public:
-	UniformBuffer(const std::shared_ptr<LogicalDevice>& device);
+	UniformBuffer(const std::shared_ptr<LogicalDevice>& device, uint32_t sizePerFrame = VulkanConfig::UniformBufferSizePerFrame);
 	~UniformBuffer();
 
-	const std::vector<VkBuffer>& GetBuffers() const { return m_buffers; }
+	// Call once the GPU is done with the frame, everything allocated for it before is gone
+	void Reset(uint32_t frameIndex);
+	// Makes the writes of the current frame visible to the GPU
+	void Flush();
+
+	// Safe to call from multiple threads
+	UniformAllocation Allocate(uint32_t size);
+
+	template<typename T>
+	uint32_t Push(const T& data)
+	{
+		UniformAllocation allocation = Allocate(sizeof(T));
+		memcpy(allocation.Data, &data, sizeof(T));
+
+		return allocation.Offset;
+	}
+
+	VkBuffer GetBuffer() const { return m_buffer; }
 
 private:
 	std::shared_ptr<LogicalDevice> m_logicalDevice;
-	// size?
 
-	std::vector<VkBuffer> m_buffers;
-	std::vector<VmaAllocation> m_allocations;
-	std::vector<void*> m_memoryMaps;
+	VkBuffer m_buffer;
+	VmaAllocation m_allocation;
+	uint8_t* m_data = nullptr;
+
+	uint32_t m_alignment;
+	uint32_t m_sizePerFrame;
 
-	friend class Swapchain; // remove
+	uint32_t m_frameOffset = 0;
+	std::atomic<uint32_t> m_head = 0;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "VertexBuffer.h"
 
 #include "../Application.h"
+#include "../Memory/DeletionCommandQueue.h"
 #include "../Vertex.h"
 
 VertexBuffer::VertexBuffer(void* data, uint32_t size)
@@ -10,58 +11,62 @@ VertexBuffer::VertexBuffer(void* data, uint32_t size)
 }
 
 VertexBuffer::VertexBuffer(uint32_t size)
+	: m_size(size)
 {
-	CreateBuffer(nullptr, size);
+	m_dynamicBuffer = std::make_unique<DynamicBuffer>(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 }
 
 VertexBuffer::~VertexBuffer()
 {
-	Allocator::DestroyBuffer(m_buffer, m_allocation);
+	if (m_dynamicBuffer)
+		return;
+
+	// Can't pull the buffer out from under a copy that is still in flight
+	Application::Get().GetUploadContext()->Wait(m_uploadTicket);
+
+	// Frames in flight may still be drawing with it
+	Allocator::UnregisterMovable(m_allocation);
+	DeletionCommandQueue::DestroyBuffer(m_buffer, m_allocation);
 }
 
 void VertexBuffer::SetData(void* data, uint32_t size)
 {
-	// TODO: implement
+	if (!m_dynamicBuffer)
+	{
+		LOG("SetData() called on a static vertex buffer!");
+		return;
+	}
+
+	m_dynamicBuffer->SetData(data, size);
+	m_size = size;
 }
 
 void VertexBuffer::CreateBuffer(void* data, uint32_t size)
 {
-	// To stage or not to stage (staging buffer)
-	VkBufferCreateInfo stagingBufferInfo{};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.size = size;
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	stagingBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	VkBuffer stagingBuffer;
-	VmaAllocation stagingBufferAlloc = Allocator::AllocateBuffer(stagingBuffer, stagingBufferInfo, VMA_MEMORY_USAGE_CPU_TO_GPU);
-
-	void* memData = Allocator::MapMemory(stagingBufferAlloc);
-	if (data)
-		memcpy(memData, data, (size_t)size);
-	else
-		memset(memData, 0, (size_t)size);
-	Allocator::UnmapMemory(stagingBufferAlloc);
+	StagingAllocation staging = Allocator::AllocateStaging(data, size);
 
 	// Vertex buffer
 	VkBufferCreateInfo vertexBufferInfo{};
 	vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	vertexBufferInfo.size = size;
-	vertexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	vertexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 	vertexBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	m_allocation = Allocator::AllocateBuffer(m_buffer, vertexBufferInfo, VMA_MEMORY_USAGE_GPU_ONLY);
+	m_allocation = Allocator::AllocateBuffer(m_buffer, vertexBufferInfo, AllocationCategory::Vertex, VMA_MEMORY_USAGE_GPU_ONLY);
+
+	auto& uploadContext = Application::Get().GetUploadContext();
+	uploadContext->Record([&](VkCommandBuffer commandBuffer)
+	{
+		VkBufferCopy copyRegion{};
+		copyRegion.srcOffset = staging.Offset;
+		copyRegion.dstOffset = 0;
+		copyRegion.size = size;
 
-	auto& device = Application::Get().GetDevice();
-	VkCommandBuffer commandBuffer = device->GetCommandBuffer(true);
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuffer, staging.Buffer, m_buffer, 1, &copyRegion);
+	});
 
-	vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_buffer, 1, &copyRegion);
-	device->FlushCommandBuffer(commandBuffer);
+	m_uploadTicket = uploadContext->ReleaseBufferToGraphics(m_buffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	uploadContext->ReleaseOnComplete(staging);
 
-	// Clean up
-	Allocator::DestroyBuffer(stagingBuffer, stagingBufferAlloc);
+	Allocator::RegisterMovable(m_allocation, &m_buffer, vertexBufferInfo, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
@@ -1,17 +1,23 @@
 #pragma once
 
+#include "DynamicBuffer.h"
+#include "../Device/UploadContext.h"
 #include "../Memory/Allocator.h"
 
 class VertexBuffer
 {
 public:
+	// Static, device local buffer
 	VertexBuffer(void* data, uint32_t size);
+	// Dynamic buffer, fill it every frame with SetData()
 	VertexBuffer(uint32_t size);
 	~VertexBuffer();
 
 	void SetData(void* data, uint32_t size);
 
-	VkBuffer GetBuffer() const { return m_buffer; }
+	VkBuffer GetBuffer() const { return m_dynamicBuffer ? m_dynamicBuffer->GetBuffer() : m_buffer; }
+	bool IsDynamic() const { return m_dynamicBuffer != nullptr; }
+	UploadTicket GetUploadTicket() const { return m_uploadTicket; }
 
 private:
 	void CreateBuffer(void* data, uint32_t size);
@@ -19,6 +25,10 @@ private:
 private:
 	uint32_t m_size;
 
-	VkBuffer m_buffer;
-	VmaAllocation m_allocation;
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+	VmaAllocation m_allocation = VK_NULL_HANDLE;
+
+	std::unique_ptr<DynamicBuffer> m_dynamicBuffer;
+
+	UploadTicket m_uploadTicket = 0;
 };
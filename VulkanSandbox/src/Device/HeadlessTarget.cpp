@@ -0,0 +1,231 @@
+#include "HeadlessTarget.h"
+
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+
+HeadlessTarget::HeadlessTarget(const std::shared_ptr<LogicalDevice>& device, uint32_t width, uint32_t height, ReadbackFn readbackFn)
+	: RenderTarget(device), m_readbackFn(readbackFn)
+{
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	m_extent = { width, height };
+
+	CreateFrameResources();
+
+	m_targets.resize(VulkanConfig::MaxFramesInFlight);
+	m_imageViews.resize(VulkanConfig::MaxFramesInFlight);
+
+	for (size_t i = 0; i < m_targets.size(); i++)
+	{
+		Target& target = m_targets[i];
+
+		// Image
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = width;
+		imageInfo.extent.height = height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = s_format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+		target.Allocation = Allocator::AllocateImage(target.Image, imageInfo, AllocationCategory::Image, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+		// Image view
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = target.Image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = s_format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		VK_CHECK(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &target.View), "Failed to create image view!");
+		m_imageViews[i] = target.View;
+
+		if (!m_readbackFn)
+			continue;
+
+		// Readback buffer, read on the host in whatever order the callback likes
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = (VkDeviceSize)width * height * 4;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		target.BufferAllocation = Allocator::AllocateBuffer(target.Buffer, bufferInfo, AllocationCategory::Staging, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = m_commandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &target.CommandBuffer), "Failed to create readback command buffer!");
+	}
+
+	CreateRenderPass(s_format, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	CreateFramebuffers(m_imageViews);
+
+	LOG("Rendering headless at " << width << "x" << height << (m_readbackFn ? " with readback" : ""));
+}
+
+void HeadlessTarget::BeginFrame()
+{
+	PROFILE_SCOPE("HeadlessTarget::BeginFrame");
+
+	WaitForFrame();
+
+	// The copy was part of the frame that was just waited on
+	if (m_targets[m_currentFrameIndex].Pending)
+		DeliverReadback(m_currentFrameIndex);
+
+	// Every frame slot has its own image
+	m_currentIndex = m_currentFrameIndex;
+
+	vkResetFences(m_logicalDevice->GetNativeDevice(), 1, &m_fences[m_currentFrameIndex]);
+
+	vkResetCommandBuffer(m_commandBuffers[m_currentFrameIndex], 0);
+}
+
+void HeadlessTarget::Present()
+{
+	PROFILE_SCOPE("HeadlessTarget::Present");
+
+	Target& target = m_targets[m_currentFrameIndex];
+
+	VkCommandBuffer commandBuffers[] = { m_commandBuffers[m_currentFrameIndex], target.CommandBuffer };
+
+	if (m_readbackFn)
+		RecordReadback(target.CommandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = m_readbackFn ? 2 : 1;
+	submitInfo.pCommandBuffers = commandBuffers;
+
+	Submit(submitInfo);
+	m_lastPresentTiming.PresentTime = m_lastPresentTiming.SubmitTime;
+
+	target.Pending = m_readbackFn != nullptr;
+	target.FrameNumber = m_frameNumber++;
+
+	AdvanceFrame();
+}
+
+void HeadlessTarget::Cleanup()
+{
+	if (m_isCleanedUp)
+		return;
+
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	DestroyFramebuffers();
+
+	for (auto& target : m_targets)
+	{
+		vkDestroyImageView(logicalDevice, target.View, nullptr);
+		Allocator::DestroyImage(target.Image, target.Allocation);
+	}
+
+	vkDestroyRenderPass(logicalDevice, m_renderPass, nullptr);
+
+	m_isCleanedUp = true;
+}
+
+void HeadlessTarget::Destroy()
+{
+	Cleanup();
+
+	// Oldest first, so frames arrive in order
+	std::vector<uint32_t> pending;
+	for (uint32_t i = 0; i < (uint32_t)m_targets.size(); i++)
+	{
+		if (m_targets[i].Pending)
+			pending.push_back(i);
+	}
+
+	std::sort(pending.begin(), pending.end(), [&](uint32_t a, uint32_t b) { return m_targets[a].FrameNumber < m_targets[b].FrameNumber; });
+
+	for (uint32_t frameIndex : pending)
+		DeliverReadback(frameIndex);
+
+	for (auto& target : m_targets)
+	{
+		if (target.Buffer)
+			Allocator::DestroyBuffer(target.Buffer, target.BufferAllocation);
+	}
+
+	DestroyFrameResources();
+}
+
+void HeadlessTarget::RecordReadback(VkCommandBuffer commandBuffer)
+{
+	Target& target = m_targets[m_currentFrameIndex];
+
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin readback command buffer!");
+
+	// The render pass leaves the image in TRANSFER_SRC_OPTIMAL and its external dependency covers the copy
+	VkBufferImageCopy copyRegion{};
+	copyRegion.bufferOffset = 0;
+	copyRegion.bufferRowLength = 0;
+	copyRegion.bufferImageHeight = 0;
+	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.imageSubresource.mipLevel = 0;
+	copyRegion.imageSubresource.baseArrayLayer = 0;
+	copyRegion.imageSubresource.layerCount = 1;
+	copyRegion.imageOffset = { 0, 0, 0 };
+	copyRegion.imageExtent = { m_extent.width, m_extent.height, 1 };
+
+	vkCmdCopyImageToBuffer(commandBuffer, target.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.Buffer, 1, &copyRegion);
+
+	// Make the copy visible to the host once the fence signals
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = target.Buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to record readback command buffer!");
+}
+
+void HeadlessTarget::DeliverReadback(uint32_t frameIndex)
+{
+	PROFILE_SCOPE("HeadlessTarget::DeliverReadback");
+
+	Target& target = m_targets[frameIndex];
+	target.Pending = false;
+
+	Allocator::InvalidateMemory(target.BufferAllocation, 0, VK_WHOLE_SIZE);
+
+	ReadbackFrame frame;
+	frame.FrameNumber = target.FrameNumber;
+	frame.Width = m_extent.width;
+	frame.Height = m_extent.height;
+	frame.Format = s_format;
+	frame.Pixels = (const uint8_t*)Allocator::GetMappedData(target.BufferAllocation);
+
+	m_readbackFn(frame);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "RenderTarget.h"
+
+#include "../Memory/Allocator.h"
+
+#include <functional>
+
+// A finished frame in host memory, only valid during the callback
+struct ReadbackFrame
+{
+	uint64_t FrameNumber;
+	uint32_t Width;
+	uint32_t Height;
+	VkFormat Format;
+	const uint8_t* Pixels; // Tightly packed rows
+};
+
+// Renders into a ring of offscreen images, one per frame in flight, for machines without a display.
+// With a readback callback every frame is copied into a host visible buffer of its frame slot. The
+// copy is part of the frame's submit and the callback runs once BeginFrame() has waited on the slot's
+// fence anyway, so reading back never stalls the pipeline.
+class HeadlessTarget : public RenderTarget
+{
+public:
+	using ReadbackFn = std::function<void(const ReadbackFrame& frame)>;
+
+	HeadlessTarget(const std::shared_ptr<LogicalDevice>& device, uint32_t width, uint32_t height, ReadbackFn readbackFn = nullptr);
+
+	void BeginFrame() override;
+	void Present() override;
+
+	void Cleanup() override;
+	// Hands out the frames still in flight, the device has to be idle
+	void Destroy() override;
+
+	const char* GetPresentModeName() const override { return "Headless"; }
+
+private:
+	void RecordReadback(VkCommandBuffer commandBuffer);
+	void DeliverReadback(uint32_t frameIndex);
+
+private:
+	static constexpr VkFormat s_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	struct Target
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView View = VK_NULL_HANDLE;
+		VmaAllocation Allocation = VK_NULL_HANDLE;
+
+		// Readback
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VmaAllocation BufferAllocation = VK_NULL_HANDLE;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		bool Pending = false;
+		uint64_t FrameNumber = 0;
+	};
+
+	std::vector<Target> m_targets; // Per frame in flight
+	std::vector<VkImageView> m_imageViews;
+
+	ReadbackFn m_readbackFn;
+	uint64_t m_frameNumber = 0;
+	bool m_isCleanedUp = false;
+};
\ No newline at end of file
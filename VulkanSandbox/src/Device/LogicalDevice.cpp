@@ -1,16 +1,30 @@
 #include "LogicalDevice.h"
 
-LogicalDevice::LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevice)
+#include "../Profiling/Profiler.h"
+
+LogicalDevice::LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevice, bool presentation)
 	: m_physicalDevice(physicalDevice)
 {
-	bool extensionsSupported = true;
 	for (const auto& extension : VulkanConfig::DeviceExtensions)
+	{
+		if (!presentation && strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0)
+			continue;
+
+		m_enabledExtensions.push_back(extension);
+	}
+
+	bool extensionsSupported = true;
+	for (const auto& extension : m_enabledExtensions)
 		if (!m_physicalDevice->IsExtensionSupported(extension))
 			extensionsSupported = false;
 
 	if (!extensionsSupported)
 		throw std::runtime_error("Not all device extensions were supported!");
 
+	for (const auto& extension : VulkanConfig::OptionalDeviceExtensions)
+		if (m_physicalDevice->IsExtensionSupported(extension))
+			m_enabledExtensions.push_back(extension);
+
 	QueueFamilyIndices indices = m_physicalDevice->GetQueueFamilyIndices();
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	float queuePriority = 1.0f;
@@ -22,15 +36,30 @@ LogicalDevice::LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevi
 	graphicsQueueCreateInfo.pQueuePriorities = &queuePriority;
 	queueCreateInfos.push_back(graphicsQueueCreateInfo);
 
+	if (indices.HasDedicatedTransfer())
+	{
+		VkDeviceQueueCreateInfo transferQueueCreateInfo{};
+		transferQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		transferQueueCreateInfo.queueFamilyIndex = indices.Transfer;
+		transferQueueCreateInfo.queueCount = 1;
+		transferQueueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfos.push_back(transferQueueCreateInfo);
+	}
+
 	VkPhysicalDeviceFeatures deviceFeatures = m_physicalDevice->GetDeviceFeatures();
 
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.hostQueryReset = m_physicalDevice->SupportsHostQueryReset();
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &features12;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = (uint32_t)VulkanConfig::DeviceExtensions.size();
-	createInfo.ppEnabledExtensionNames = VulkanConfig::DeviceExtensions.data();
+	createInfo.enabledExtensionCount = (uint32_t)m_enabledExtensions.size();
+	createInfo.ppEnabledExtensionNames = m_enabledExtensions.data();
 	if (VulkanConfig::EnableValidation)
 	{
 		createInfo.enabledLayerCount = (uint32_t)VulkanConfig::ValidationLayers.size();
@@ -43,6 +72,7 @@ LogicalDevice::LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevi
 	VK_CHECK(vkCreateDevice(m_physicalDevice->GetNativeDevice(), &createInfo, nullptr, &m_device), "Failed to create logical device!");
 
 	vkGetDeviceQueue(m_device, indices.Graphics, 0, &m_graphicsQueue);
+	vkGetDeviceQueue(m_device, indices.Transfer, 0, &m_transferQueue);
 
 	VkCommandPoolCreateInfo commandPoolInfo{};
 	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -54,9 +84,19 @@ LogicalDevice::LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevi
 
 void LogicalDevice::Destroy()
 {
+	vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 	vkDestroyDevice(m_device, nullptr);
 }
 
+bool LogicalDevice::IsExtensionEnabled(const std::string& extension) const
+{
+	for (const auto& enabledExtension : m_enabledExtensions)
+		if (extension == enabledExtension)
+			return true;
+
+	return false;
+}
+
 VkCommandBuffer LogicalDevice::GetCommandBuffer(bool begin)
 {
 	VkCommandBuffer commandBuffer;
@@ -83,6 +123,8 @@ VkCommandBuffer LogicalDevice::GetCommandBuffer(bool begin)
 
 void LogicalDevice::FlushCommandBuffer(VkCommandBuffer commandBuffer)
 {
+	PROFILE_SCOPE("LogicalDevice::FlushCommandBuffer");
+
 	VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to end command buffer requested from logical device!");
 
 	VkSubmitInfo submitInfo{};
@@ -5,7 +5,8 @@
 class LogicalDevice
 {
 public:
-	LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevice);
+	// Without presentation the swapchain extension isn't required, so headless drivers work too
+	LogicalDevice(const std::shared_ptr<PhysicalDevice>& physicalDevice, bool presentation = true);
 
 	void Destroy();
 
@@ -15,13 +16,19 @@ public:
 	const std::shared_ptr<PhysicalDevice>& GetPhysicalDevice() const { return m_physicalDevice; }
 	VkDevice GetNativeDevice() { return m_device; }
 	VkQueue GetGraphicsQueue() { return m_graphicsQueue; }
+	VkQueue GetTransferQueue() { return m_transferQueue; } // Graphics queue when there is no dedicated transfer family
+
+	bool IsExtensionEnabled(const std::string& extension) const;
 
 private:
 	std::shared_ptr<PhysicalDevice> m_physicalDevice;
 	VkDevice m_device;
 
 	VkQueue m_graphicsQueue;
+	VkQueue m_transferQueue;
 
 	VkCommandPool m_commandPool;
+
+	std::vector<const char*> m_enabledExtensions;
 };
 
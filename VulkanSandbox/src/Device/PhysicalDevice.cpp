@@ -41,6 +41,16 @@ PhysicalDevice::PhysicalDevice()
 	vkGetPhysicalDeviceFeatures(m_physicalDevice, &m_features);
 	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
 
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features2{};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &features12;
+
+	vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+	m_hostQueryReset = features12.hostQueryReset;
+
 	// Queue Family Indices
 	m_indices = FindQueueFamilyIndices();
 
@@ -63,6 +73,23 @@ bool PhysicalDevice::IsExtensionSupported(std::string_view name)
 	return std::find(m_supportedExtensions.begin(), m_supportedExtensions.end(), name) != m_supportedExtensions.end();
 }
 
+bool PhysicalDevice::SupportsSampledImage(VkFormat format) const
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+
+	return properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+}
+
+bool PhysicalDevice::SupportsLinearBlit(VkFormat format) const
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & required) == required;
+}
+
 QueueFamilyIndices PhysicalDevice::FindQueueFamilyIndices()
 {
 	QueueFamilyIndices indices;
@@ -72,21 +99,50 @@ QueueFamilyIndices PhysicalDevice::FindQueueFamilyIndices()
 
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+	m_queueFamilies = queueFamilies;
 
 	for (size_t i = 0; i < queueFamilies.size(); i++)
 	{
-		if (queueFamilies[i].queueFlags && VK_QUEUE_GRAPHICS_BIT)
-			indices.Graphics = i;
+		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			indices.Graphics = (int32_t)i;
+			break;
+		}
 
 		//VkBool32 presentSupport = false;
 		//vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, i, m_surface, &presentSupport);
 
 		//if (presentSupport)
 		//	indices.PresentFamily = i;
+	}
 
-		if (indices.IsComplete())
-			break;
+	// Prefer a transfer-only family (DMA engine), then any transfer family without graphics
+	int32_t transferNoCompute = -1;
+	int32_t transferNoGraphics = -1;
+
+	for (size_t i = 0; i < queueFamilies.size(); i++)
+	{
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+		if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+			continue;
+
+		if (!(flags & VK_QUEUE_COMPUTE_BIT) && transferNoCompute < 0)
+			transferNoCompute = (int32_t)i;
+		else if (transferNoGraphics < 0)
+			transferNoGraphics = (int32_t)i;
 	}
 
+	if (transferNoCompute > -1)
+		indices.Transfer = transferNoCompute;
+	else if (transferNoGraphics > -1)
+		indices.Transfer = transferNoGraphics;
+	else
+		indices.Transfer = indices.Graphics; // e.g. lavapipe, everything goes through the graphics queue
+
+	std::stringstream ss;
+	ss << "Using queue family " << indices.Graphics << " for graphics and " << indices.Transfer << " for transfers";
+	LOG(ss.str());
+
 	return indices;
 }
@@ -5,10 +5,16 @@
 struct QueueFamilyIndices
 {
 	int32_t Graphics = -1;
+	int32_t Transfer = -1; // Same as Graphics when there is no dedicated transfer family
 
 	bool IsComplete()
 	{
-		return Graphics > -1;
+		return Graphics > -1 && Transfer > -1;
+	}
+
+	bool HasDedicatedTransfer() const
+	{
+		return Transfer != Graphics;
 	}
 };
 
@@ -23,6 +29,15 @@ public:
 	const VkPhysicalDevice GetNativeDevice() const { return m_physicalDevice; }
 
 	bool IsExtensionSupported(std::string_view name);
+	// Optimal tiling images of the format can be sampled, block compressed formats need their feature
+	bool SupportsSampledImage(VkFormat format) const;
+	// Optimal tiling images of the format can be blitted with linear filtering
+	bool SupportsLinearBlit(VkFormat format) const;
+	// Query pools can be reset with vkResetQueryPool, outside of any command buffer
+	bool SupportsHostQueryReset() const { return m_hostQueryReset; }
+
+	// 0 when the queue family can't write timestamps
+	uint32_t GetTimestampValidBits(uint32_t queueFamily) const { return m_queueFamilies[queueFamily].timestampValidBits; }
 
 private:
 	QueueFamilyIndices FindQueueFamilyIndices();
@@ -32,8 +47,10 @@ private:
 	VkPhysicalDeviceProperties m_properties;
 	VkPhysicalDeviceFeatures m_features;
 	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	bool m_hostQueryReset = false;
 
 	QueueFamilyIndices m_indices;
+	std::vector<VkQueueFamilyProperties> m_queueFamilies;
 
 	std::vector<std::string> m_supportedExtensions;
 };
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "RenderTarget.h"
+
+#include "../Memory/DeletionCommandQueue.h"
+
+RenderTarget::RenderTarget(const std::shared_ptr<LogicalDevice>& device)
+	: m_logicalDevice(device)
+{
+
+}
+
+void RenderTarget::CreateFrameResources()
+{
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	// Command pool
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolInfo.queueFamilyIndex = m_logicalDevice->GetPhysicalDevice()->GetQueueFamilyIndices().Graphics;
+
+	VK_CHECK(vkCreateCommandPool(logicalDevice, &commandPoolInfo, nullptr, &m_commandPool), "Failed to create command pool!");
+
+	// Command buffers
+	m_commandBuffers.resize(VulkanConfig::MaxFramesInFlight);
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = (uint32_t)m_commandBuffers.size();
+
+	VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocInfo, m_commandBuffers.data()), "Failed to create command buffer!");
+
+	// Fences
+	m_fences.resize(VulkanConfig::MaxFramesInFlight);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (auto& fence : m_fences)
+		VK_CHECK(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &fence), "Failed to create fence!");
+}
+
+void RenderTarget::DestroyFrameResources()
+{
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	for (auto& fence : m_fences)
+		vkDestroyFence(logicalDevice, fence, nullptr);
+
+	vkDestroyCommandPool(logicalDevice, m_commandPool, nullptr);
+}
+
+void RenderTarget::CreateRenderPass(VkFormat format, VkImageLayout finalLayout)
+{
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = format;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = finalLayout;
+
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpassDescription{};
+	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpassDescription.colorAttachmentCount = 1;
+	subpassDescription.pColorAttachments = &colorAttachmentRef;
+
+	VkSubpassDependency subpassDependency{};
+	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependency.dstSubpass = 0;
+	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDependency.srcAccessMask = 0;
+	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	// Offscreen images get copied out after the pass, which has to wait for the writes and the final layout transition
+	VkSubpassDependency readbackDependency{};
+	readbackDependency.srcSubpass = 0;
+	readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkSubpassDependency dependencies[] = { subpassDependency, readbackDependency };
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpassDescription;
+	renderPassInfo.dependencyCount = finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ? 2 : 1;
+	renderPassInfo.pDependencies = dependencies;
+
+	VK_CHECK(vkCreateRenderPass(m_logicalDevice->GetNativeDevice(), &renderPassInfo, nullptr, &m_renderPass), "Failed to create render pass!");
+}
+
+void RenderTarget::CreateFramebuffers(const std::vector<VkImageView>& imageViews)
+{
+	m_framebuffers.resize(imageViews.size());
+
+	for (size_t i = 0; i < imageViews.size(); i++)
+	{
+		VkImageView attachments[] = {
+			imageViews[i]
+		};
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = attachments;
+		framebufferInfo.width = m_extent.width;
+		framebufferInfo.height = m_extent.height;
+		framebufferInfo.layers = 1;
+
+		VK_CHECK(vkCreateFramebuffer(m_logicalDevice->GetNativeDevice(), &framebufferInfo, nullptr, &m_framebuffers[i]), "Failed to create framebuffer!");
+	}
+}
+
+void RenderTarget::DestroyFramebuffers()
+{
+	for (auto& framebuffer : m_framebuffers)
+		vkDestroyFramebuffer(m_logicalDevice->GetNativeDevice(), framebuffer, nullptr);
+
+	m_framebuffers.clear();
+}
+
+void RenderTarget::WaitForFrame()
+{
+	vkWaitForFences(m_logicalDevice->GetNativeDevice(), 1, &m_fences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+
+	// Whatever was released while the frame we just waited on was recorded is no longer in use
+	DeletionCommandQueue::Execute();
+}
+
+void RenderTarget::Submit(const VkSubmitInfo& submitInfo)
+{
+	m_lastPresentTiming.SubmitTime = std::chrono::high_resolution_clock::now();
+	VK_CHECK(vkQueueSubmit(m_logicalDevice->GetGraphicsQueue(), 1, &submitInfo, m_fences[m_currentFrameIndex]), "Failed to submit queue!");
+}
+
+void RenderTarget::AdvanceFrame()
+{
+	m_currentFrameIndex = (m_currentFrameIndex + 1) % VulkanConfig::MaxFramesInFlight;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "LogicalDevice.h"
+
+#include <chrono>
+
+// CPU timestamps of the last Present(), the image is handed on when Present() returns
+struct PresentTiming
+{
+	std::chrono::high_resolution_clock::time_point SubmitTime;
+	std::chrono::high_resolution_clock::time_point PresentTime;
+};
+
+// What frames are rendered into, a window swapchain or offscreen images. BeginFrame() waits until the
+// frame slot is free again and picks the image, the caller records into GetRenderCommandBuffer() and
+// Present() submits it. Command buffers and fences are per frame in flight and live here.
+class RenderTarget
+{
+public:
+	RenderTarget(const std::shared_ptr<LogicalDevice>& device);
+	virtual ~RenderTarget() = default;
+
+	virtual void BeginFrame() = 0;
+	virtual void Present() = 0;
+
+	// Frees what depends on the images, Destroy() the rest
+	virtual void Cleanup() = 0;
+	virtual void Destroy() = 0;
+
+	// Only a window swapchain cares about these
+	virtual void SetFramebufferSize(uint32_t width, uint32_t height) {}
+	virtual void SetPresentMode(VkPresentModeKHR presentMode) {}
+	virtual const char* GetPresentModeName() const = 0;
+
+	const PresentTiming& GetLastPresentTiming() const { return m_lastPresentTiming; }
+
+	uint32_t GetWidth() const { return m_extent.width; }
+	uint32_t GetHeight() const { return m_extent.height; }
+	const VkExtent2D& GetExtent() const { return m_extent; }
+
+	// Index into everything kept per frame in flight
+	uint32_t GetCurrentFrameIndex() const { return m_currentFrameIndex; }
+	// Index of the image rendered to, unrelated to the frame index
+	uint32_t GetCurrentImageIndex() const { return m_currentIndex; }
+
+	VkRenderPass GetRenderPass() { return m_renderPass; }
+	VkFramebuffer GetCurrentFramebuffer() { return m_framebuffers[m_currentIndex]; }
+	VkCommandBuffer GetRenderCommandBuffer() { return m_commandBuffers[m_currentFrameIndex]; }
+
+protected:
+	void CreateFrameResources();
+	void DestroyFrameResources();
+
+	void CreateRenderPass(VkFormat format, VkImageLayout finalLayout);
+	void CreateFramebuffers(const std::vector<VkImageView>& imageViews);
+	void DestroyFramebuffers();
+
+	void WaitForFrame();
+	void Submit(const VkSubmitInfo& submitInfo);
+	void AdvanceFrame();
+
+protected:
+	std::shared_ptr<LogicalDevice> m_logicalDevice;
+
+	VkExtent2D m_extent{};
+	VkRenderPass m_renderPass = VK_NULL_HANDLE;
+	std::vector<VkFramebuffer> m_framebuffers; // Per image
+
+	VkCommandPool m_commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> m_commandBuffers; // Per frame in flight
+	std::vector<VkFence> m_fences;
+
+	uint32_t m_currentFrameIndex = 0;
+	uint32_t m_currentIndex = 0;
+
+	PresentTiming m_lastPresentTiming;
+};
\ No newline at end of file
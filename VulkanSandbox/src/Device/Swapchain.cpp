@@ -1,37 +1,48 @@
 #include "Swapchain.h"
 
 #include "../Application.h"
-
-#define GLM_FORCE_RADIANS
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include "../Memory/DeletionCommandQueue.h"
+#include "../Profiling/Profiler.h"
 
 #include <algorithm>
-#include <chrono>
 
-Swapchain::Swapchain(const std::shared_ptr<LogicalDevice>& device)
-	: m_logicalDevice(device)
+Swapchain::Swapchain(const std::shared_ptr<LogicalDevice>& device, uint32_t framebufferWidth, uint32_t framebufferHeight, VkPresentModeKHR presentMode)
+	: RenderTarget(device), m_requestedPresentMode(presentMode), m_framebufferWidth(framebufferWidth), m_framebufferHeight(framebufferHeight)
 {
+	auto& app = Application::Get();
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	// Window surface
+	VK_CHECK(glfwCreateWindowSurface(app.GetInstance(), app.GetWindow(), nullptr, &m_surface), "Failed to create window surface!");
+
+	// Command buffers, fences and acquire semaphores are per frame in flight and outlive swapchain recreation
+	CreateFrameResources();
+
+	m_acquireSemaphores.resize(VulkanConfig::MaxFramesInFlight);
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (auto& semaphore : m_acquireSemaphores)
+		VK_CHECK(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore), "Failed to create acquire semaphore!");
+
 	Create();
 }
 
-void Swapchain::Create()
+void Swapchain::Create(VkSwapchainKHR oldSwapchain)
 {
-	auto app = Application::Get();
-	VkInstance instance = app.GetInstance();
 	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
 
-	// Window surface
-	VK_CHECK(glfwCreateWindowSurface(instance, app.GetWindow(), nullptr, &m_surface), "Failed to create window surface!");
-	
 	// Swapchain
 	SwapchainSupportDetails details = QuerySwapchainSupport();
 
 	VkSurfaceFormatKHR format = ChooseSwapSurfaceFormat(details.Formats);
-	VkPresentModeKHR presentMode = ChooseSwapPresentMode(details.PresentModes);
+	m_supportedPresentModes = details.PresentModes;
+	m_presentMode = ChooseSwapPresentMode(details.PresentModes);
 	VkExtent2D extent = ChooseSwapExtent(details.Capabilities);
 
-	uint32_t imageCount = details.Capabilities.minImageCount + 1;
+	// Enough images that every frame in flight can hold one
+	uint32_t imageCount = std::max(details.Capabilities.minImageCount + 1, VulkanConfig::MaxFramesInFlight);
 	if (details.Capabilities.maxImageCount > 0 && imageCount > details.Capabilities.maxImageCount)
 		imageCount = details.Capabilities.maxImageCount;
 
@@ -40,9 +51,9 @@ void Swapchain::Create()
 	createInfo.surface = m_surface;
 	createInfo.preTransform = details.Capabilities.currentTransform;
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	createInfo.presentMode = presentMode;
+	createInfo.presentMode = m_presentMode;
 	createInfo.clipped = VK_TRUE;
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = oldSwapchain; // Lets the driver hand over resources, the old one is retired either way
 	createInfo.minImageCount = imageCount;
 	createInfo.imageFormat = format.format;
 	createInfo.imageColorSpace = format.colorSpace;
@@ -64,8 +75,11 @@ void Swapchain::Create()
 	m_images.resize(imageCount);
 	vkGetSwapchainImagesKHR(logicalDevice, m_swapchain, &imageCount, m_images.data());
 
-	m_width = extent.width;
-	m_height = extent.height;
+	m_imageFences.assign(imageCount, VK_NULL_HANDLE);
+
+	// Pipelines are built against the render pass, it only has to change with the format
+	bool formatChanged = m_renderPass == VK_NULL_HANDLE || format.format != m_format;
+
 	m_extent = extent;
 	m_format = format.format;
 
@@ -92,120 +106,51 @@ void Swapchain::Create()
 		VK_CHECK(vkCreateImageView(logicalDevice, &createInfo, nullptr, &m_imageViews[i]), "Failed to create image view!");
 	}
 
-	// Command pool
-	VkCommandPoolCreateInfo commandPoolInfo{};
-	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	commandPoolInfo.queueFamilyIndex = indices.Graphics;
-
-	VK_CHECK(vkCreateCommandPool(logicalDevice, &commandPoolInfo, nullptr, &m_commandPool), "Failed to create command pool!");
+	// Per image
+	m_renderSemaphores.resize(m_images.size());
 
-	// Command buffers
-	m_commandBuffers.resize(VulkanConfig::MaxFramesInFlight);
-
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = m_commandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint32_t)m_commandBuffers.size();
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocInfo, m_commandBuffers.data()), "Failed to create command buffer!");
+	for (auto& semaphore : m_renderSemaphores)
+		VK_CHECK(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &semaphore), "Failed to create render semaphore!");
 
 	m_isCleanedUp = false;
 
-	// Sync objects
-	m_fences.resize(VulkanConfig::MaxFramesInFlight);
-
-	VkSemaphoreCreateInfo semaphoreInfo{};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	VK_CHECK(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &m_presentSemaphore), "Failed to create present semaphore!");
-	VK_CHECK(vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &m_renderSemaphore), "Failed to create render semaphore!");
-
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
-		VK_CHECK(vkCreateFence(logicalDevice, &fenceInfo, nullptr, &m_fences[i]), "Failed to create fence!");
-
-	// Render pass
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = m_format;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpassDescription{};
-	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpassDescription.colorAttachmentCount = 1;
-	subpassDescription.pColorAttachments = &colorAttachmentRef;
-
-	VkSubpassDependency subpassDependency{};
-	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependency.dstSubpass = 0;
-	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependency.srcAccessMask = 0;
-	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	VkRenderPassCreateInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.pSubpasses = &subpassDescription;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &subpassDependency;
-
-	VK_CHECK(vkCreateRenderPass(m_logicalDevice->GetNativeDevice(), &renderPassInfo, nullptr, &m_renderPass), "Failed to create render pass!");
-
-	// Framebuffers
-	m_framebuffers.resize(m_imageViews.size());
-
-	for (size_t i = 0; i < m_imageViews.size(); i++)
+	if (formatChanged)
 	{
-		VkImageView attachments[] = {
-			m_imageViews[i]
-		};
-
-		VkFramebufferCreateInfo framebufferInfo{};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_renderPass;
-		framebufferInfo.attachmentCount = 1;
-		framebufferInfo.pAttachments = attachments;
-		framebufferInfo.width = m_extent.width;
-		framebufferInfo.height = m_extent.height;
-		framebufferInfo.layers = 1;
-
-		VK_CHECK(vkCreateFramebuffer(logicalDevice, &framebufferInfo, nullptr, &m_framebuffers[i]), "Failed to create framebuffer!");
+		if (m_renderPass != VK_NULL_HANDLE)
+		{
+			LOG("Swapchain format changed, pipelines created against the old render pass are no longer compatible");
+			DeletionCommandQueue::DestroyRenderPass(m_renderPass);
+		}
+
+		CreateRenderPass(m_format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 	}
+
+	CreateFramebuffers(m_imageViews);
 }
 
 void Swapchain::Recreate()
 {
-	GLFWwindow* window = Application::Get().GetWindow();
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
+	PROFILE_SCOPE("Swapchain::Recreate");
 
-	while (width == 0 || height == 0) // Window minimized
-	{
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
-	}
+	// Frames still in flight keep using the old objects, they are retired through the deletion queue
+	// instead of waiting for the device to go idle. The old swapchain goes last, its images may still
+	// be waiting on presentation.
+	for (auto& framebuffer : m_framebuffers)
+		DeletionCommandQueue::DestroyFramebuffer(framebuffer);
+	m_framebuffers.clear();
 
-	vkDeviceWaitIdle(m_logicalDevice->GetNativeDevice());
+	for (auto& imageView : m_imageViews)
+		DeletionCommandQueue::DestroyImageView(imageView);
 
-	Cleanup();
-	Create();
+	for (auto& semaphore : m_renderSemaphores)
+		DeletionCommandQueue::DestroySemaphore(semaphore);
+
+	VkSwapchainKHR oldSwapchain = m_swapchain;
+	Create(oldSwapchain);
+	DeletionCommandQueue::DestroySwapchain(oldSwapchain);
 
 	m_recreateNeeded = false;
 }
@@ -217,13 +162,20 @@ void Swapchain::Cleanup()
 
 	auto logicalDevice = m_logicalDevice->GetNativeDevice();
 
-	for (auto& framebuffer : m_framebuffers)
-		vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+	DestroyFramebuffers();
 
 	for (auto& imageView : m_imageViews)
 		vkDestroyImageView(logicalDevice, imageView, nullptr);
 
+	// The image count may change with the new swapchain
+	for (auto& semaphore : m_renderSemaphores)
+		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+
+	vkDestroyRenderPass(logicalDevice, m_renderPass, nullptr);
+	m_renderPass = VK_NULL_HANDLE;
+
 	vkDestroySwapchainKHR(logicalDevice, m_swapchain, nullptr);
+	m_swapchain = VK_NULL_HANDLE;
 
 	m_isCleanedUp = true;
 }
@@ -233,45 +185,54 @@ void Swapchain::Destroy()
 	auto logicalDevice = m_logicalDevice->GetNativeDevice();
 
 	Cleanup();
-	
-	vkDestroyRenderPass(logicalDevice, m_renderPass, nullptr);
 
-	vkDestroySemaphore(logicalDevice, m_presentSemaphore, nullptr);
-	vkDestroySemaphore(logicalDevice, m_renderSemaphore, nullptr);
-	
-	for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
-		vkDestroyFence(logicalDevice, m_fences[i], nullptr);
+	for (auto& semaphore : m_acquireSemaphores)
+		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
 
-	vkDestroyCommandPool(logicalDevice, m_commandPool, nullptr);
-}
+	DestroyFrameResources();
 
-void Swapchain::DestroySurface()
-{
-	auto instance = Application::Get().GetInstance();
+	// Retired swapchains still in the deletion queue have to go before their surface, the device is idle here
+	DeletionCommandQueue::Flush();
 
-	vkDestroySurfaceKHR(instance, m_surface, nullptr);
+	// Instance level, can go as soon as the swapchain is gone
+	vkDestroySurfaceKHR(Application::Get().GetInstance(), m_surface, nullptr);
 }
 
 void Swapchain::BeginFrame()
 {
-	vkWaitForFences(m_logicalDevice->GetNativeDevice(), 1, &m_fences[m_currentFrameIndex], VK_TRUE, UINT64_MAX);
+	PROFILE_SCOPE("Swapchain::BeginFrame");
+
+	WaitForFrame();
+
+	VkPresentModeKHR requestedPresentMode = m_requestedPresentMode;
+	if (requestedPresentMode != m_presentMode)
+	{
+		if (std::find(m_supportedPresentModes.begin(), m_supportedPresentModes.end(), requestedPresentMode) != m_supportedPresentModes.end())
+		{
+			m_recreateNeeded = true;
+		} else
+		{
+			LOG("Present mode " << GetPresentModeName(requestedPresentMode) << " not supported, staying on " << GetPresentModeName(m_presentMode));
+			m_requestedPresentMode = m_presentMode;
+		}
+	}
 
 	if (m_recreateNeeded)
 		Recreate();
 
 	m_currentIndex = GetNextImage();
 
-	static auto startTime = std::chrono::high_resolution_clock::now();
-	auto currentTime = std::chrono::high_resolution_clock::now();
-	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
-	UniformBufferObject ubo;
-	ubo.Model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.View = glm::lookAt(glm::vec3(2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.Projection = glm::perspective(glm::radians(45.0f), m_extent.width / (float)m_extent.height, 0.1f, 10.0f);
-	ubo.Projection[1][1] *= -1;
+	// Nothing was acquired, so the acquire semaphore is still unsignalled and can be used again right away
+	if (m_recreateNeeded)
+	{
+		Recreate();
+		m_currentIndex = GetNextImage();
+	}
 
-	memcpy(Application::Get().GetUniformBuffer()->m_memoryMaps[m_currentFrameIndex], &ubo, sizeof(ubo));
+	// Only matters when the image was acquired out of order, usually its frame finished long ago
+	if (m_imageFences[m_currentIndex] != VK_NULL_HANDLE)
+		vkWaitForFences(m_logicalDevice->GetNativeDevice(), 1, &m_imageFences[m_currentIndex], VK_TRUE, UINT64_MAX);
+	m_imageFences[m_currentIndex] = m_fences[m_currentFrameIndex];
 
 	vkResetFences(m_logicalDevice->GetNativeDevice(), 1, &m_fences[m_currentFrameIndex]);
 
@@ -280,53 +241,82 @@ void Swapchain::BeginFrame()
 
 void Swapchain::Present()
 {
+	PROFILE_SCOPE("Swapchain::Present");
+
 	VkResult result;
 	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &m_presentSemaphore;
+	submitInfo.pWaitSemaphores = &m_acquireSemaphores[m_currentFrameIndex];
 	submitInfo.pWaitDstStageMask = &waitStage;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrameIndex];
 	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &m_renderSemaphore;
+	submitInfo.pSignalSemaphores = &m_renderSemaphores[m_currentIndex];
 	
-	VK_CHECK(vkQueueSubmit(m_logicalDevice->GetGraphicsQueue(), 1, &submitInfo, m_fences[m_currentFrameIndex]), "Failed to submit queue!");
+	Submit(submitInfo);
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &m_renderSemaphore;
+	presentInfo.pWaitSemaphores = &m_renderSemaphores[m_currentIndex];
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = &m_swapchain;
 	presentInfo.pImageIndices = &m_currentIndex;
 	presentInfo.pResults = nullptr;
 
 	result = vkQueuePresentKHR(m_logicalDevice->GetGraphicsQueue(), &presentInfo);
-	
+	m_lastPresentTiming.PresentTime = std::chrono::high_resolution_clock::now();
+
+	// Recreated at the start of the next frame, once its slot is free
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 		OnResize();
 
-	m_currentFrameIndex = (m_currentFrameIndex + 1) % VulkanConfig::MaxFramesInFlight;
+	AdvanceFrame();
 }
 
 void Swapchain::OnResize()
 {
-	auto logicalDevice = m_logicalDevice->GetNativeDevice();
-	vkDeviceWaitIdle(logicalDevice);
-	Recreate();
-	vkDeviceWaitIdle(logicalDevice);
+	m_recreateNeeded = true;
+}
+
+void Swapchain::SetFramebufferSize(uint32_t width, uint32_t height)
+{
+	m_framebufferWidth = width;
+	m_framebufferHeight = height;
+}
+
+void Swapchain::SetPresentMode(VkPresentModeKHR presentMode)
+{
+	m_requestedPresentMode = presentMode;
+}
+
+const char* Swapchain::GetPresentModeName() const
+{
+	return GetPresentModeName(m_presentMode);
+}
+
+const char* Swapchain::GetPresentModeName(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+		case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+		default: return "Unknown";
+	}
 }
 
 uint32_t Swapchain::GetNextImage()
 {
 	uint32_t imageIndex{ 0 };
-	VkResult result = vkAcquireNextImageKHR(m_logicalDevice->GetNativeDevice(), m_swapchain, UINT64_MAX, m_presentSemaphore, VK_NULL_HANDLE, &imageIndex);
+	VkResult result = vkAcquireNextImageKHR(m_logicalDevice->GetNativeDevice(), m_swapchain, UINT64_MAX, m_acquireSemaphores[m_currentFrameIndex], VK_NULL_HANDLE, &imageIndex);
 
-	// TODO: Defer this?
-	// VK_SUBOPTIMAL_KHR can be used for rendering, but recreating is advised
+	// VK_SUBOPTIMAL_KHR can be used for rendering, but recreating is advised. Present() reports it too,
+	// so it is left to the next frame.
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		m_recreateNeeded = true;
 
@@ -379,10 +369,11 @@ VkPresentModeKHR Swapchain::ChooseSwapPresentMode(const std::vector<VkPresentMod
 {
 	for (const auto& presentMode : availablePresentModes)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentMode == m_requestedPresentMode)
 			return presentMode;
 	}
 
+	// Always supported
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -391,10 +382,7 @@ VkExtent2D Swapchain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilit
 	if (capabilities.currentExtent.width != UINT32_MAX)
 		return capabilities.currentExtent;
 
-	int width{ 0 }, height{ 0 };
-	glfwGetFramebufferSize(Application::Get().GetWindow(), &width, &height);
-
-	VkExtent2D actualExtent = { (uint32_t)width, (uint32_t)height };
+	VkExtent2D actualExtent = { m_framebufferWidth, m_framebufferHeight };
 
 	actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
 	actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
@@ -1,6 +1,8 @@
 #pragma once
 
-#include "LogicalDevice.h"
+#include "RenderTarget.h"
+
+#include <atomic>
 
 struct SwapchainSupportDetails
 {
@@ -9,31 +11,32 @@ struct SwapchainSupportDetails
 	std::vector<VkPresentModeKHR> PresentModes;
 };
 
-class Swapchain
+// Presents to the window. Submit to present ends when vkQueuePresentKHR returns, not at scanout.
+class Swapchain : public RenderTarget
 {
 public:
-	Swapchain(const std::shared_ptr<LogicalDevice>& device);
+	Swapchain(const std::shared_ptr<LogicalDevice>& device, uint32_t framebufferWidth, uint32_t framebufferHeight, VkPresentModeKHR presentMode);
 
-	void Create();
+	void Create(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+	// Never waits for the device, the old swapchain and everything built on it are released once the frames in flight are done
 	void Recreate();
-	void Cleanup();
-	void Destroy();
-	void DestroySurface();
+	void Cleanup() override;
+	void Destroy() override;
 
-	void BeginFrame();
-	void Present();
+	void BeginFrame() override;
+	void Present() override;
 
 	void OnResize();
 
-	uint32_t GetWidth() const { return m_width; }
-	uint32_t GetHeight() const { return m_height; }
-
-	uint32_t GetCurrentImageIndex() const { return m_currentFrameIndex; }
+	// Recreation may run on the render thread, which can't query the window, so the main thread passes the size in
+	void SetFramebufferSize(uint32_t width, uint32_t height) override;
 
-	VkRenderPass GetRenderPass() { return m_renderPass; }
-	VkFramebuffer GetCurrentFramebuffer() { return m_framebuffers[m_currentFrameIndex]; }
-	VkCommandBuffer GetRenderCommandBuffer() { return m_commandBuffers[m_currentFrameIndex]; } 
-	const VkExtent2D& GetExtent() const { return m_extent; }
+	// Can be called from any thread, applied in the next BeginFrame(). The swapchain is only recreated when the
+	// surface supports the mode and it differs from the current one.
+	void SetPresentMode(VkPresentModeKHR presentMode) override;
+	VkPresentModeKHR GetPresentMode() const { return m_presentMode; }
+	const char* GetPresentModeName() const override;
+	static const char* GetPresentModeName(VkPresentModeKHR presentMode);
 
 private:
 	uint32_t GetNextImage();
@@ -44,30 +47,22 @@ private:
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 private:
-	std::shared_ptr<LogicalDevice> m_logicalDevice;
-
 	VkSurfaceKHR m_surface;
-	VkSwapchainKHR m_swapchain;
-	VkExtent2D m_extent;
-	VkFormat m_format;
-
-	VkRenderPass m_renderPass;
-
-	VkSemaphore m_presentSemaphore;
-	VkSemaphore m_renderSemaphore;
-	std::vector<VkFence> m_fences;
-
-	VkCommandPool m_commandPool;
-	std::vector<VkCommandBuffer> m_commandBuffers;
-
-	uint32_t m_currentFrameIndex = 0;
-	uint32_t m_currentIndex = 0;
-	uint32_t m_width, m_height;
+	VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+	VkFormat m_format = VK_FORMAT_UNDEFINED;
+	std::atomic<VkPresentModeKHR> m_presentMode{ VK_PRESENT_MODE_FIFO_KHR };
+	std::atomic<VkPresentModeKHR> m_requestedPresentMode;
+	std::vector<VkPresentModeKHR> m_supportedPresentModes;
+
+	std::vector<VkSemaphore> m_acquireSemaphores; // Per frame in flight
+	std::vector<VkSemaphore> m_renderSemaphores; // Per image, presentation may still wait on it when the frame comes around again
+	std::vector<VkFence> m_imageFences; // Fence of the frame that last rendered to the image, images can be acquired out of order
+	std::atomic<uint32_t> m_framebufferWidth{ 0 };
+	std::atomic<uint32_t> m_framebufferHeight{ 0 };
 
 	bool m_recreateNeeded = false;
 	bool m_isCleanedUp = false;
 
 	std::vector<VkImage> m_images;
 	std::vector<VkImageView> m_imageViews;
-	std::vector<VkFramebuffer> m_framebuffers;
 };
@@ -0,0 +1,365 @@
+#include "UploadContext.h"
+
+#include "../Application.h"
+#include "../Memory/Allocator.h"
+
+UploadContext::UploadContext(const std::shared_ptr<LogicalDevice>& device)
+	: m_logicalDevice(device)
+{
+	QueueFamilyIndices indices = m_logicalDevice->GetPhysicalDevice()->GetQueueFamilyIndices();
+
+	m_dedicatedTransfer = indices.HasDedicatedTransfer();
+	m_transferFamily = indices.Transfer;
+	m_graphicsFamily = indices.Graphics;
+	m_timestampValidBits = m_logicalDevice->GetPhysicalDevice()->GetTimestampValidBits(m_transferFamily);
+	m_hostQueryReset = m_logicalDevice->GetPhysicalDevice()->SupportsHostQueryReset();
+
+	// Transfer only command buffers can't reset query pools, without a host reset uploads go untimed
+	if (m_dedicatedTransfer && !m_hostQueryReset)
+		m_timestampValidBits = 0;
+
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolInfo.queueFamilyIndex = m_transferFamily;
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VK_CHECK(vkCreateCommandPool(m_logicalDevice->GetNativeDevice(), &commandPoolInfo, nullptr, &m_transferCommandPool), "Failed to create upload command pool!");
+
+	if (m_dedicatedTransfer)
+	{
+		commandPoolInfo.queueFamilyIndex = m_graphicsFamily;
+		VK_CHECK(vkCreateCommandPool(m_logicalDevice->GetNativeDevice(), &commandPoolInfo, nullptr, &m_graphicsCommandPool), "Failed to create upload command pool!");
+	}
+}
+
+void UploadContext::Destroy()
+{
+	VkDevice device = m_logicalDevice->GetNativeDevice();
+
+	Submit();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	while (!m_submittedBatches.empty())
+	{
+		Batch& batch = m_submittedBatches.front();
+		vkWaitForFences(device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+		Retire(batch);
+		m_submittedBatches.pop_front();
+	}
+
+	for (auto& batch : m_freeBatches)
+	{
+		vkDestroyFence(device, batch.Fence, nullptr);
+
+		if (batch.TransferSemaphore)
+			vkDestroySemaphore(device, batch.TransferSemaphore, nullptr);
+
+		if (batch.QueryPool)
+			vkDestroyQueryPool(device, batch.QueryPool, nullptr);
+	}
+
+	m_freeBatches.clear();
+
+	vkDestroyCommandPool(device, m_transferCommandPool, nullptr);
+
+	if (m_graphicsCommandPool)
+		vkDestroyCommandPool(device, m_graphicsCommandPool, nullptr);
+}
+
+UploadTicket UploadContext::ReleaseBufferToGraphics(VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Batch& batch = GetRecordingBatch();
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	if (!m_dedicatedTransfer)
+	{
+		vkCmdPipelineBarrier(batch.TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+		return batch.Ticket;
+	}
+
+	barrier.srcQueueFamilyIndex = m_transferFamily;
+	barrier.dstQueueFamilyIndex = m_graphicsFamily;
+
+	// Release, the access mask of the destination is ignored here
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(batch.TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	// Acquire, the semaphore wait takes care of the availability of the transfer writes
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(batch.GraphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	return batch.Ticket;
+}
+
+UploadTicket UploadContext::ReleaseImageToGraphics(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Batch& batch = GetRecordingBatch();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = dstAccess;
+
+	if (!m_dedicatedTransfer)
+	{
+		vkCmdPipelineBarrier(batch.TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		return batch.Ticket;
+	}
+
+	// Release and acquire have to specify the same layout transition
+	barrier.srcQueueFamilyIndex = m_transferFamily;
+	barrier.dstQueueFamilyIndex = m_graphicsFamily;
+
+	barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(batch.TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccess;
+	vkCmdPipelineBarrier(batch.GraphicsCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	return batch.Ticket;
+}
+
+void UploadContext::ReleaseOnComplete(const StagingAllocation& staging)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	GetRecordingBatch().StagingAllocations.push_back(staging);
+}
+
+UploadTicket UploadContext::Submit()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_isRecording)
+		return m_nextTicket - 1;
+
+	Batch& batch = m_recordingBatch;
+
+	if (batch.QueryPool)
+		vkCmdWriteTimestamp(batch.TransferCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, batch.QueryPool, 1);
+
+	VK_CHECK(vkEndCommandBuffer(batch.TransferCommandBuffer), "Failed to end upload command buffer!");
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.TransferCommandBuffer;
+
+	if (!m_dedicatedTransfer)
+	{
+		VK_CHECK(vkQueueSubmit(m_logicalDevice->GetGraphicsQueue(), 1, &submitInfo, batch.Fence), "Failed to submit upload batch!");
+	} else
+	{
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch.TransferSemaphore;
+
+		VK_CHECK(vkQueueSubmit(m_logicalDevice->GetTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit upload batch!");
+
+		// Acquire side, this is submitted ahead of the frame so the frame sees the resources
+		VK_CHECK(vkEndCommandBuffer(batch.GraphicsCommandBuffer), "Failed to end upload command buffer!");
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo acquireInfo{};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = &batch.TransferSemaphore;
+		acquireInfo.pWaitDstStageMask = &waitStage;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &batch.GraphicsCommandBuffer;
+
+		VK_CHECK(vkQueueSubmit(m_logicalDevice->GetGraphicsQueue(), 1, &acquireInfo, batch.Fence), "Failed to submit upload acquire!");
+	}
+
+	m_submittedBatches.push_back(std::move(batch));
+	m_isRecording = false;
+
+	return m_submittedBatches.back().Ticket;
+}
+
+void UploadContext::Update()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// The fence is signalled on the graphics queue after the transfer work, so batches complete in order
+	while (!m_submittedBatches.empty())
+	{
+		Batch& batch = m_submittedBatches.front();
+		if (vkGetFenceStatus(m_logicalDevice->GetNativeDevice(), batch.Fence) != VK_SUCCESS)
+			break;
+
+		Retire(batch);
+		m_submittedBatches.pop_front();
+	}
+}
+
+bool UploadContext::IsComplete(UploadTicket ticket)
+{
+	if (ticket <= m_completedTicket)
+		return true;
+
+	Update();
+
+	return ticket <= m_completedTicket;
+}
+
+void UploadContext::Wait(UploadTicket ticket)
+{
+	if (IsComplete(ticket))
+		return;
+
+	bool needsSubmit;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		needsSubmit = m_isRecording && m_recordingBatch.Ticket <= ticket;
+	}
+
+	if (needsSubmit)
+		Submit();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto& batch : m_submittedBatches)
+		{
+			if (batch.Ticket == ticket)
+			{
+				vkWaitForFences(m_logicalDevice->GetNativeDevice(), 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+				break;
+			}
+		}
+	}
+
+	Update();
+}
+
+UploadContext::Batch& UploadContext::GetRecordingBatch()
+{
+	if (m_isRecording)
+		return m_recordingBatch;
+
+	if (m_freeBatches.empty())
+	{
+		m_recordingBatch = CreateBatch();
+	} else
+	{
+		m_recordingBatch = std::move(m_freeBatches.back());
+		m_freeBatches.pop_back();
+	}
+
+	m_recordingBatch.Ticket = m_nextTicket++;
+
+	// The batch is retired or new, so none of its queries are in use
+	if (m_recordingBatch.QueryPool && m_hostQueryReset)
+		vkResetQueryPool(m_logicalDevice->GetNativeDevice(), m_recordingBatch.QueryPool, 0, 2);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VK_CHECK(vkBeginCommandBuffer(m_recordingBatch.TransferCommandBuffer, &beginInfo), "Failed to begin upload command buffer!");
+
+	if (m_dedicatedTransfer)
+		VK_CHECK(vkBeginCommandBuffer(m_recordingBatch.GraphicsCommandBuffer, &beginInfo), "Failed to begin upload command buffer!");
+
+	if (m_recordingBatch.QueryPool)
+	{
+		if (!m_hostQueryReset)
+			vkCmdResetQueryPool(m_recordingBatch.TransferCommandBuffer, m_recordingBatch.QueryPool, 0, 2);
+
+		vkCmdWriteTimestamp(m_recordingBatch.TransferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_recordingBatch.QueryPool, 0);
+	}
+
+	m_isRecording = true;
+
+	return m_recordingBatch;
+}
+
+UploadContext::Batch UploadContext::CreateBatch()
+{
+	VkDevice device = m_logicalDevice->GetNativeDevice();
+	Batch batch;
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_transferCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &batch.TransferCommandBuffer), "Failed to allocate upload command buffer!");
+
+	if (m_dedicatedTransfer)
+	{
+		allocInfo.commandPool = m_graphicsCommandPool;
+		VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &batch.GraphicsCommandBuffer), "Failed to allocate upload command buffer!");
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		VK_CHECK(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.TransferSemaphore), "Failed to create upload semaphore!");
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &batch.Fence), "Failed to create upload fence!");
+
+	// Batches are timed on their own, they may be recorded on any thread and don't belong to a frame
+	if (m_timestampValidBits)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo{};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2;
+
+		VK_CHECK(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &batch.QueryPool), "Failed to create upload query pool!");
+	}
+
+	return batch;
+}
+
+void UploadContext::Retire(Batch& batch)
+{
+	const auto& profiler = Application::Get().GetGpuProfiler();
+	if (batch.QueryPool && profiler)
+	{
+		// The fence has signalled, so the results are there
+		uint64_t timestamps[2];
+		if (vkGetQueryPoolResults(m_logicalDevice->GetNativeDevice(), batch.QueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			profiler->AddSample("Upload", profiler->ToMilliseconds(timestamps[0], timestamps[1], m_timestampValidBits));
+	}
+
+	for (const auto& staging : batch.StagingAllocations)
+		Allocator::FreeStaging(staging);
+
+	batch.StagingAllocations.clear();
+	m_completedTicket = batch.Ticket;
+
+	vkResetFences(m_logicalDevice->GetNativeDevice(), 1, &batch.Fence);
+	vkResetCommandBuffer(batch.TransferCommandBuffer, 0);
+
+	if (batch.GraphicsCommandBuffer)
+		vkResetCommandBuffer(batch.GraphicsCommandBuffer, 0);
+
+	m_freeBatches.push_back(std::move(batch));
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "LogicalDevice.h"
+#include "../Memory/StagingRing.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+using UploadTicket = uint64_t;
+
+// Batches upload work (copies, layout transitions) into one command buffer that gets submitted
+// once per frame. Record() may be called from any thread, Submit() and Update() must be called
+// from the thread that owns the queues.
+//
+// Copies run on the dedicated transfer queue when the device has one. Resources then have to be
+// handed over to the graphics queue family with one of the Release*ToGraphics() calls, which
+// record the release barrier on the transfer queue and the matching acquire on the graphics queue.
+class UploadContext
+{
+public:
+	UploadContext(const std::shared_ptr<LogicalDevice>& device);
+
+	void Destroy();
+
+	// Transfer queue work
+	template<typename Fn>
+	UploadTicket Record(Fn&& fn)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		Batch& batch = GetRecordingBatch();
+		fn(batch.TransferCommandBuffer);
+
+		return batch.Ticket;
+	}
+
+	// Work that needs the graphics queue (blits), executed after the transfer work of the same batch
+	template<typename Fn>
+	UploadTicket RecordGraphics(Fn&& fn)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		Batch& batch = GetRecordingBatch();
+		fn(m_dedicatedTransfer ? batch.GraphicsCommandBuffer : batch.TransferCommandBuffer);
+
+		return batch.Ticket;
+	}
+
+	UploadTicket ReleaseBufferToGraphics(VkBuffer buffer, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+	UploadTicket ReleaseImageToGraphics(VkImage image, const VkImageSubresourceRange& range, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+
+	// Staging memory is returned to the ring when the batch it was recorded in has completed
+	void ReleaseOnComplete(const StagingAllocation& staging);
+
+	UploadTicket Submit();
+	void Update();
+
+	bool IsComplete(UploadTicket ticket);
+	void Wait(UploadTicket ticket);
+
+	bool HasDedicatedTransfer() const { return m_dedicatedTransfer; }
+
+private:
+	struct Batch
+	{
+		VkCommandBuffer TransferCommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer GraphicsCommandBuffer = VK_NULL_HANDLE; // Only used with a dedicated transfer queue
+		VkSemaphore TransferSemaphore = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		VkQueryPool QueryPool = VK_NULL_HANDLE; // Start and end of the transfer work, for the GPU profiler
+		UploadTicket Ticket = 0;
+
+		std::vector<StagingAllocation> StagingAllocations;
+	};
+
+	Batch& GetRecordingBatch();
+	Batch CreateBatch();
+	void Retire(Batch& batch);
+
+private:
+	std::shared_ptr<LogicalDevice> m_logicalDevice;
+
+	bool m_dedicatedTransfer;
+	uint32_t m_transferFamily;
+	uint32_t m_graphicsFamily;
+	uint32_t m_timestampValidBits; // Of the transfer family, 0 when it can't write timestamps
+	bool m_hostQueryReset;
+
+	VkCommandPool m_transferCommandPool;
+	VkCommandPool m_graphicsCommandPool = VK_NULL_HANDLE;
+
+	bool m_isRecording = false;
+	Batch m_recordingBatch;
+	std::deque<Batch> m_submittedBatches;
+	std::vector<Batch> m_freeBatches;
+
+	UploadTicket m_nextTicket = 1;
+	std::atomic<UploadTicket> m_completedTicket = 0;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
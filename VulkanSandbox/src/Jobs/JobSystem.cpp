@@ -0,0 +1,311 @@
+#include "JobSystem.h"
+
+#include "Profiling/Profiler.h"
+#include "Vulkan.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job
+{
+	JobFn Fn;
+	JobCounter* Counter = nullptr;
+	JobCounter* Dependency = nullptr;
+	bool Background = false;
+};
+
+struct JobQueue
+{
+	std::deque<Job> Jobs;
+	std::mutex Mutex;
+};
+
+struct JobSystemData
+{
+	std::vector<std::thread> Threads;
+	std::vector<std::unique_ptr<JobQueue>> Queues; // Per worker
+	JobQueue SharedQueue;
+	JobQueue BackgroundQueue;
+
+	std::atomic<uint32_t> PendingJobs{ 0 };
+
+	// Jobs whose dependency isn't done yet, queued by the job that brings its counter to zero
+	std::vector<Job> ParkedJobs;
+	std::mutex ParkedMutex;
+
+	bool Running = true;
+	std::mutex WakeMutex;
+	std::condition_variable WakeCondition;
+};
+
+static JobSystemData* s_data = nullptr;
+static thread_local int32_t t_workerIndex = -1;
+
+static void Enqueue(Job&& job)
+{
+	// Counted before it can be popped, taking the lock below orders the increment before a sleeping worker's check
+	s_data->PendingJobs++;
+
+	JobQueue* queue = &s_data->SharedQueue;
+	if (job.Background)
+		queue = &s_data->BackgroundQueue;
+	else if (t_workerIndex >= 0 && !job.Dependency)
+		queue = s_data->Queues[t_workerIndex].get();
+
+	{
+		std::lock_guard<std::mutex> lock(queue->Mutex);
+		queue->Jobs.push_back(std::move(job));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(s_data->WakeMutex);
+	}
+	s_data->WakeCondition.notify_one();
+}
+
+static void ReleaseParked(JobCounter* counter)
+{
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(s_data->ParkedMutex);
+
+		auto it = std::partition(s_data->ParkedJobs.begin(), s_data->ParkedJobs.end(), [counter](const Job& job) { return job.Dependency != counter; });
+		std::move(it, s_data->ParkedJobs.end(), std::back_inserter(released));
+		s_data->ParkedJobs.erase(it, s_data->ParkedJobs.end());
+	}
+
+	for (auto& job : released)
+		Enqueue(std::move(job));
+}
+
+static void Execute(Job& job)
+{
+	{
+		PROFILE_SCOPE("Job");
+		job.Fn();
+	}
+
+	// The last job of the counter hands its dependents to the queues
+	if (job.Counter && job.Counter->Value.fetch_sub(1, std::memory_order_acq_rel) == 1 && s_data)
+		ReleaseParked(job.Counter);
+}
+
+static bool PopBack(JobQueue& queue, Job& job)
+{
+	std::lock_guard<std::mutex> lock(queue.Mutex);
+	if (queue.Jobs.empty())
+		return false;
+
+	job = std::move(queue.Jobs.back());
+	queue.Jobs.pop_back();
+	return true;
+}
+
+static bool PopFront(JobQueue& queue, Job& job)
+{
+	std::lock_guard<std::mutex> lock(queue.Mutex);
+	if (queue.Jobs.empty())
+		return false;
+
+	job = std::move(queue.Jobs.front());
+	queue.Jobs.pop_front();
+	return true;
+}
+
+static void Push(Job&& job)
+{
+	if (job.Counter)
+		job.Counter->Value.fetch_add(1, std::memory_order_relaxed);
+
+	// Everything runs inline then, so the dependency is already done
+	if (!s_data)
+	{
+		Execute(job);
+		return;
+	}
+
+	// Parked jobs are not pending, so idle workers sleep instead of popping them over and over. The check
+	// is under the lock ReleaseParked takes, a counter reaching zero either sees the job or we see zero.
+	if (job.Dependency)
+	{
+		std::lock_guard<std::mutex> lock(s_data->ParkedMutex);
+		if (!job.Dependency->IsDone())
+		{
+			s_data->ParkedJobs.push_back(std::move(job));
+			return;
+		}
+	}
+
+	Enqueue(std::move(job));
+}
+
+static bool TryPop(Job& job, bool background)
+{
+	uint32_t queueCount = (uint32_t)s_data->Queues.size();
+	uint32_t start = 0;
+
+	// Own jobs newest first, they are most likely still in cache
+	if (t_workerIndex >= 0)
+	{
+		if (PopBack(*s_data->Queues[t_workerIndex], job))
+		{
+			s_data->PendingJobs--;
+			return true;
+		}
+
+		start = t_workerIndex + 1;
+	}
+
+	if (PopFront(s_data->SharedQueue, job))
+	{
+		s_data->PendingJobs--;
+		return true;
+	}
+
+	// Steal the oldest job of someone else, usually the largest chunk of work left
+	for (uint32_t i = 0; i < queueCount; i++)
+	{
+		uint32_t victim = (start + i) % queueCount;
+		if (victim == (uint32_t)t_workerIndex)
+			continue;
+
+		if (PopFront(*s_data->Queues[victim], job))
+		{
+			s_data->PendingJobs--;
+			return true;
+		}
+	}
+
+	// Last, only when there is nothing else
+	if (background && PopFront(s_data->BackgroundQueue, job))
+	{
+		s_data->PendingJobs--;
+		return true;
+	}
+
+	return false;
+}
+
+static void WorkerLoop(uint32_t workerIndex)
+{
+	t_workerIndex = (int32_t)workerIndex;
+	PROFILE_THREAD("Worker");
+
+	while (true)
+	{
+		Job job;
+		if (TryPop(job, true))
+		{
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(s_data->WakeMutex);
+		s_data->WakeCondition.wait(lock, []() { return !s_data->Running || s_data->PendingJobs > 0; });
+
+		// Queued jobs still run on shutdown, their counters may be waited on
+		if (!s_data->Running && s_data->PendingJobs == 0)
+			return;
+	}
+}
+
+void JobSystem::Run(JobFn fn, JobCounter* counter)
+{
+	Push({ std::move(fn), counter });
+}
+
+void JobSystem::RunBackground(JobFn fn, JobCounter* counter)
+{
+	Push({ std::move(fn), counter, nullptr, true });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, JobFn fn, JobCounter* counter)
+{
+	Push({ std::move(fn), counter, &dependency });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		Job job;
+		if (s_data && TryPop(job, false))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFn& fn)
+{
+	if (count == 0)
+		return;
+
+	// A few batches per thread evens out uneven items, more only adds overhead
+	uint32_t threadCount = GetWorkerCount() + 1;
+	uint32_t minBatch = std::max(minBatchSize, 1u);
+	uint32_t batchCount = std::min((count + minBatch - 1) / minBatch, threadCount * 4);
+
+	if (batchCount <= 1)
+	{
+		fn(0, count);
+		return;
+	}
+
+	uint32_t batchSize = (count + batchCount - 1) / batchCount;
+
+	JobCounter counter;
+	for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+	{
+		uint32_t end = std::min(begin + batchSize, count);
+		Run([&fn, begin, end]() { fn(begin, end); }, &counter);
+	}
+
+	// The first batch runs right here
+	fn(0, std::min(batchSize, count));
+
+	Wait(counter);
+}
+
+uint32_t JobSystem::GetWorkerCount()
+{
+	return s_data ? (uint32_t)s_data->Threads.size() : 0;
+}
+
+void JobSystem::Init(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	s_data = new JobSystemData();
+
+	s_data->Queues.resize(threadCount);
+	for (auto& queue : s_data->Queues)
+		queue = std::make_unique<JobQueue>();
+
+	// Workers only start once the queues exist
+	for (uint32_t i = 0; i < threadCount; i++)
+		s_data->Threads.emplace_back(WorkerLoop, i);
+
+	LOG("Job system running " << threadCount << " worker threads");
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_data->WakeMutex);
+		s_data->Running = false;
+	}
+	s_data->WakeCondition.notify_all();
+
+	for (auto& thread : s_data->Threads)
+		thread.join();
+
+	delete s_data;
+	s_data = nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+// Number of jobs still outstanding, pass it to Wait() to join them
+struct JobCounter
+{
+	std::atomic<uint32_t> Value{ 0 };
+
+	bool IsDone() const { return Value.load(std::memory_order_acquire) == 0; }
+};
+
+using JobFn = std::function<void()>;
+// Processes the items [begin, end)
+using ParallelForFn = std::function<void(uint32_t begin, uint32_t end)>;
+
+// Work stealing scheduler. Every worker owns a deque it pushes to and pops from at the back, idle
+// workers steal from the front of the others. Jobs from threads outside the pool (main and render
+// thread) go to a shared queue. Waiting threads run jobs instead of sleeping, so a job can wait on
+// other jobs without starving the pool, background jobs excepted. Without Init() every job runs inline.
+class JobSystem
+{
+public:
+	static void Run(JobFn fn, JobCounter* counter = nullptr);
+	// Low priority, for asset loads and file writes. Only idle workers take these, never a thread in Wait(),
+	// so a frame can't stall behind one. Waiting on one inside a job needs another worker to get to it.
+	static void RunBackground(JobFn fn, JobCounter* counter = nullptr);
+	// Parked until the dependency is done, which has to outlive the job. Only counters of jobs run here count.
+	static void RunAfter(JobCounter& dependency, JobFn fn, JobCounter* counter = nullptr);
+	// Runs other jobs meanwhile. Inside a job, only wait on jobs it started itself, others may be
+	// further down the stack of this thread.
+	static void Wait(JobCounter& counter);
+
+	// Splits [0, count) into batches of at least minBatchSize items and blocks until all of them ran,
+	// the calling thread takes part
+	static void ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFn& fn);
+
+	// Not counting the threads that help out in Wait()
+	static uint32_t GetWorkerCount();
+
+	// A thread count of 0 uses all cores but the main one
+	static void Init(uint32_t threadCount = 0);
+	static void Shutdown();
+};
\ No newline at end of file
@@ -1,80 +1,116 @@
 #include "Allocator.h"
 
 #include "Application.h"
+#include "Profiling/Profiler.h"
 
+#include <atomic>
+#include <fstream>
 #include <sstream>
 
+struct CategoryCounters
+{
+	std::atomic<uint64_t> Bytes = 0;
+	std::atomic<uint64_t> PeakBytes = 0;
+	std::atomic<uint64_t> Count = 0;
+};
+
 struct Vma
 {
 	VmaAllocator Allocator;
-	uint64_t MemoryUsed = 0;
+
+	std::array<CategoryCounters, (size_t)AllocationCategory::Count> Categories;
+	std::atomic<uint64_t> TotalBytes = 0;
+	std::atomic<uint64_t> PeakBytes = 0;
+	std::atomic<uint64_t> AllocationCount = 0;
+
+	std::unique_ptr<StagingRing> Staging;
+	std::unique_ptr<Defragmenter> Defragmentation;
 };
 
 static Vma* s_data = nullptr;
-static std::stringstream ss;
 
-VmaAllocation Allocator::AllocateBuffer(VkBuffer& buffer, VkBufferCreateInfo createInfo, VmaMemoryUsage usage)
+static void UpdatePeak(std::atomic<uint64_t>& peak, uint64_t value)
+{
+	uint64_t current = peak.load(std::memory_order_relaxed);
+	while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+static void TrackAllocation(AllocationCategory category, uint64_t size)
+{
+	auto& counters = s_data->Categories[(size_t)category];
+
+	UpdatePeak(counters.PeakBytes, counters.Bytes.fetch_add(size, std::memory_order_relaxed) + size);
+	counters.Count.fetch_add(1, std::memory_order_relaxed);
+
+	UpdatePeak(s_data->PeakBytes, s_data->TotalBytes.fetch_add(size, std::memory_order_relaxed) + size);
+	s_data->AllocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void TrackFree(VmaAllocation allocation)
 {
+	VmaAllocationInfo allocationInfo{};
+	vmaGetAllocationInfo(s_data->Allocator, allocation, &allocationInfo);
+
+	auto& counters = s_data->Categories[(size_t)allocationInfo.pUserData];
+
+	counters.Bytes.fetch_sub(allocationInfo.size, std::memory_order_relaxed);
+	counters.Count.fetch_sub(1, std::memory_order_relaxed);
+	s_data->TotalBytes.fetch_sub(allocationInfo.size, std::memory_order_relaxed);
+}
+
+VmaAllocation Allocator::AllocateBuffer(VkBuffer& buffer, VkBufferCreateInfo createInfo, AllocationCategory category, VmaMemoryUsage usage, VmaAllocationCreateFlags flags)
+{
+	PROFILE_SCOPE("Allocator::AllocateBuffer");
+
 	VmaAllocationCreateInfo allocCreateInfo{};
 	allocCreateInfo.usage = usage;
+	allocCreateInfo.flags = flags;
+	allocCreateInfo.pUserData = (void*)(uintptr_t)category;
 
 	VmaAllocationInfo allocationInfo{};
 
 	VmaAllocation allocation;
-	vmaCreateBuffer(s_data->Allocator, &createInfo, &allocCreateInfo, &buffer, &allocation, &allocationInfo);
-
-	s_data->MemoryUsed += allocationInfo.size;
+	VK_CHECK(vmaCreateBuffer(s_data->Allocator, &createInfo, &allocCreateInfo, &buffer, &allocation, &allocationInfo), "Failed to allocate buffer!");
 
-	ss.str("");
-	ss << "[GPU] Memory allocated: " << allocationInfo.size << ", Total memory in use: " << s_data->MemoryUsed / 1000000.0f << " MB (" << s_data->MemoryUsed << " bytes)";
-	LOG(ss.str());
+	TrackAllocation(category, allocationInfo.size);
 
 	return allocation;
 }
 
-VmaAllocation Allocator::AllocateImage(VkImage& image, VkImageCreateInfo createInfo, VmaMemoryUsage usage)
+VmaAllocation Allocator::AllocateImage(VkImage& image, VkImageCreateInfo createInfo, AllocationCategory category, VmaMemoryUsage usage)
 {
+	PROFILE_SCOPE("Allocator::AllocateImage");
+
 	VmaAllocationCreateInfo allocCreateInfo{};
 	allocCreateInfo.usage = usage;
+	allocCreateInfo.pUserData = (void*)(uintptr_t)category;
 
 	VmaAllocationInfo allocationInfo{};
 
 	VmaAllocation allocation;
-	vmaCreateImage(s_data->Allocator, &createInfo, &allocCreateInfo, &image, &allocation, &allocationInfo);
-
-	s_data->MemoryUsed += allocationInfo.size;
+	VK_CHECK(vmaCreateImage(s_data->Allocator, &createInfo, &allocCreateInfo, &image, &allocation, &allocationInfo), "Failed to allocate image!");
 
-	ss.str("");
-	ss << "[GPU] Memory allocated: " << allocationInfo.size << ", Total memory in use: " << s_data->MemoryUsed / 1000000.0f << " MB (" << s_data->MemoryUsed << " bytes)";
-	LOG(ss.str());
+	TrackAllocation(category, allocationInfo.size);
 
 	return allocation;
 }
 
 void Allocator::DestroyBuffer(VkBuffer buffer, VmaAllocation allocation)
 {
-	VmaAllocationInfo allocationInfo{};
-	vmaGetAllocationInfo(s_data->Allocator, allocation, &allocationInfo);
-
-	s_data->MemoryUsed -= allocationInfo.size;
+	TrackFree(allocation);
 
-	ss.str("");
-	ss << "[GPU] Memory freed: " << allocationInfo.size << ", Total memory in use: " << s_data->MemoryUsed / 1000000.0f << " MB (" << s_data->MemoryUsed << " bytes)";
-	LOG(ss.str());
+	if (s_data->Defragmentation && s_data->Defragmentation->OnFreeBuffer(allocation, buffer))
+		return;
 
 	vmaDestroyBuffer(s_data->Allocator, buffer, allocation);
 }
 
 void Allocator::DestroyImage(VkImage image, VmaAllocation allocation)
 {
-	VmaAllocationInfo allocationInfo{};
-	vmaGetAllocationInfo(s_data->Allocator, allocation, &allocationInfo);
-
-	s_data->MemoryUsed -= allocationInfo.size;
+	TrackFree(allocation);
 
-	ss.str("");
-	ss << "[GPU] Memory freed: " << allocationInfo.size << ", Total memory in use: " << s_data->MemoryUsed / 1000000.0f << " MB (" << s_data->MemoryUsed << " bytes)";
-	LOG(ss.str());
+	if (s_data->Defragmentation && s_data->Defragmentation->OnFreeImage(allocation, image))
+		return;
 
 	vmaDestroyImage(s_data->Allocator, image, allocation);
 }
@@ -91,11 +127,174 @@ void Allocator::UnmapMemory(VmaAllocation allocation)
 	vmaUnmapMemory(s_data->Allocator, allocation);
 }
 
+void* Allocator::GetMappedData(VmaAllocation allocation)
+{
+	VmaAllocationInfo allocationInfo{};
+	vmaGetAllocationInfo(s_data->Allocator, allocation, &allocationInfo);
+	return allocationInfo.pMappedData;
+}
+
+void Allocator::FlushMemory(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	// No-op on host coherent memory
+	vmaFlushAllocation(s_data->Allocator, allocation, offset, size);
+}
+
+void Allocator::InvalidateMemory(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	// No-op on host coherent memory
+	vmaInvalidateAllocation(s_data->Allocator, allocation, offset, size);
+}
+
+StagingAllocation Allocator::AllocateStaging(const void* data, VkDeviceSize size)
+{
+	return s_data->Staging->Allocate(data, size);
+}
+
+void Allocator::FreeStaging(const StagingAllocation& allocation)
+{
+	s_data->Staging->Free(allocation);
+}
+
+void Allocator::RegisterMovable(VmaAllocation allocation, VkBuffer* buffer, const VkBufferCreateInfo& createInfo, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	s_data->Defragmentation->RegisterBuffer(allocation, buffer, createInfo, dstAccess, dstStage);
+}
+
+void Allocator::RegisterMovable(VmaAllocation allocation, VkImage* image, VkImageView* view, const VkImageCreateInfo& createInfo, const VkImageViewCreateInfo& viewInfo, VkImageLayout layout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	s_data->Defragmentation->RegisterImage(allocation, image, view, createInfo, viewInfo, layout, dstAccess, dstStage);
+}
+
+void Allocator::UnregisterMovable(VmaAllocation allocation)
+{
+	s_data->Defragmentation->Unregister(allocation);
+}
+
+void Allocator::Defragment()
+{
+	PROFILE_SCOPE("Allocator::Defragment");
+
+	s_data->Defragmentation->Begin();
+}
+
+void Allocator::UpdateDefragmentation()
+{
+	PROFILE_SCOPE("Allocator::UpdateDefragmentation");
+
+	s_data->Defragmentation->Update();
+}
+
+AllocatorStats Allocator::GetStats()
+{
+	AllocatorStats stats;
+
+	for (size_t i = 0; i < stats.Categories.size(); i++)
+	{
+		const auto& counters = s_data->Categories[i];
+
+		stats.Categories[i].Bytes = counters.Bytes.load(std::memory_order_relaxed);
+		stats.Categories[i].PeakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+		stats.Categories[i].Count = counters.Count.load(std::memory_order_relaxed);
+	}
+
+	stats.TotalBytes = s_data->TotalBytes.load(std::memory_order_relaxed);
+	stats.PeakBytes = s_data->PeakBytes.load(std::memory_order_relaxed);
+	stats.AllocationCount = s_data->AllocationCount.load(std::memory_order_relaxed);
+	stats.BytesReclaimed = s_data->Defragmentation->GetBytesReclaimed();
+
+	return stats;
+}
+
+std::string Allocator::GetStatsJson()
+{
+	AllocatorStats stats = GetStats();
+	std::stringstream ss;
+
+	ss << "{\n";
+	ss << "\t\"TotalBytes\": " << stats.TotalBytes << ",\n";
+	ss << "\t\"PeakBytes\": " << stats.PeakBytes << ",\n";
+	ss << "\t\"AllocationCount\": " << stats.AllocationCount << ",\n";
+	ss << "\t\"BytesReclaimed\": " << stats.BytesReclaimed << ",\n";
+
+	ss << "\t\"Categories\": {\n";
+	for (size_t i = 0; i < stats.Categories.size(); i++)
+	{
+		const auto& category = stats.Categories[i];
+
+		ss << "\t\t\"" << GetCategoryName((AllocationCategory)i) << "\": { ";
+		ss << "\"Bytes\": " << category.Bytes << ", \"PeakBytes\": " << category.PeakBytes << ", \"Count\": " << category.Count << " }";
+		ss << (i + 1 < stats.Categories.size() ? ",\n" : "\n");
+	}
+	ss << "\t},\n";
+
+	// Budgets
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(s_data->Allocator, &memoryProperties);
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+	vmaGetHeapBudgets(s_data->Allocator, budgets);
+
+	ss << "\t\"Heaps\": [\n";
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++)
+	{
+		const auto& budget = budgets[i];
+		bool deviceLocal = memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+
+		ss << "\t\t{ \"Size\": " << memoryProperties->memoryHeaps[i].size << ", \"DeviceLocal\": " << (deviceLocal ? "true" : "false");
+		ss << ", \"Usage\": " << budget.usage << ", \"Budget\": " << budget.budget;
+		ss << ", \"BlockBytes\": " << budget.statistics.blockBytes << ", \"AllocationBytes\": " << budget.statistics.allocationBytes << " }";
+		ss << (i + 1 < memoryProperties->memoryHeapCount ? ",\n" : "\n");
+	}
+	ss << "\t],\n";
+
+	// Full VMA dump, already JSON
+	char* vmaStats = nullptr;
+	vmaBuildStatsString(s_data->Allocator, &vmaStats, VK_FALSE);
+	ss << "\t\"Vma\": " << vmaStats << "\n";
+	vmaFreeStatsString(s_data->Allocator, vmaStats);
+
+	ss << "}\n";
+
+	return ss.str();
+}
+
+void Allocator::DumpStats(const std::filesystem::path& filepath)
+{
+	PROFILE_SCOPE("Allocator::DumpStats");
+
+	std::ofstream stream(filepath);
+	if (!stream)
+	{
+		LOG("Failed to open " << filepath << " for the memory stats dump!");
+		return;
+	}
+
+	stream << GetStatsJson();
+
+	LOG("[GPU] Memory stats written to " << filepath);
+}
+
+const char* Allocator::GetCategoryName(AllocationCategory category)
+{
+	switch (category)
+	{
+		case AllocationCategory::Vertex: return "Vertex";
+		case AllocationCategory::Index: return "Index";
+		case AllocationCategory::Uniform: return "Uniform";
+		case AllocationCategory::Image: return "Image";
+		case AllocationCategory::Staging: return "Staging";
+		case AllocationCategory::Other: return "Other";
+	}
+
+	return "Unknown";
+}
+
 void Allocator::Init()
 {
 	s_data = new Vma();
 
-	auto app = Application::Get();
+	auto& app = Application::Get();
 
 	VmaAllocatorCreateInfo vmaInfo{};
 	vmaInfo.instance = app.GetInstance();
@@ -103,11 +302,21 @@ void Allocator::Init()
 	vmaInfo.physicalDevice = app.GetDevice()->GetPhysicalDevice()->GetNativeDevice();
 	vmaInfo.vulkanApiVersion = VK_API_VERSION_1_3;
 
+	// Real budgets instead of estimates
+	if (app.GetDevice()->IsExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+		vmaInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
 	VK_CHECK(vmaCreateAllocator(&vmaInfo, &s_data->Allocator), "Failed to create VMA!");
+
+	s_data->Staging = std::make_unique<StagingRing>(VulkanConfig::StagingBufferSize);
+	s_data->Defragmentation = std::make_unique<Defragmenter>(s_data->Allocator);
 }
 
 void Allocator::Destroy()
 {
+	s_data->Defragmentation.reset();
+	s_data->Staging.reset();
+
 	vmaDestroyAllocator(s_data->Allocator);
 	delete s_data;
 }
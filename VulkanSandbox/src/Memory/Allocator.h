@@ -1,17 +1,79 @@
 #pragma once
 
+#include "Defragmenter.h"
+#include "StagingRing.h"
 #include "Vma.h"
 
+#include <array>
+#include <filesystem>
+#include <string>
+
+enum class AllocationCategory : uint32_t
+{
+	Vertex = 0,
+	Index,
+	Uniform,
+	Image,
+	Staging,
+	Other,
+
+	Count
+};
+
+struct AllocationCategoryStats
+{
+	uint64_t Bytes = 0;
+	uint64_t PeakBytes = 0;
+	uint64_t Count = 0;
+};
+
+struct AllocatorStats
+{
+	std::array<AllocationCategoryStats, (size_t)AllocationCategory::Count> Categories;
+
+	uint64_t TotalBytes = 0;
+	uint64_t PeakBytes = 0;
+	uint64_t AllocationCount = 0; // Since Init(), including freed allocations
+	uint64_t BytesReclaimed = 0; // By defragmentation
+};
+
 class Allocator
 {
 public:
-	static VmaAllocation AllocateBuffer(VkBuffer& buffer, VkBufferCreateInfo createInfo, VmaMemoryUsage usage = VMA_MEMORY_USAGE_AUTO);
-	static VmaAllocation AllocateImage(VkImage& image, VkImageCreateInfo createInfo, VmaMemoryUsage usage = VMA_MEMORY_USAGE_AUTO);
+	static VmaAllocation AllocateBuffer(VkBuffer& buffer, VkBufferCreateInfo createInfo, AllocationCategory category, VmaMemoryUsage usage = VMA_MEMORY_USAGE_AUTO, VmaAllocationCreateFlags flags = 0);
+	static VmaAllocation AllocateImage(VkImage& image, VkImageCreateInfo createInfo, AllocationCategory category, VmaMemoryUsage usage = VMA_MEMORY_USAGE_AUTO);
 	static void DestroyBuffer(VkBuffer buffer, VmaAllocation allocation);
 	static void DestroyImage(VkImage image, VmaAllocation allocation);
 
 	static void* MapMemory(VmaAllocation allocation);
 	static void UnmapMemory(VmaAllocation allocation);
+	static void* GetMappedData(VmaAllocation allocation);
+	static void FlushMemory(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size);
+	static void InvalidateMemory(VmaAllocation allocation, VkDeviceSize offset, VkDeviceSize size);
+
+	// Staging memory for uploads, free it once the copy has been executed by the GPU
+	static StagingAllocation AllocateStaging(const void* data, VkDeviceSize size);
+	static void FreeStaging(const StagingAllocation& allocation);
+
+	// The defragmenter may move these, it updates the handles (and view) in place
+	static void RegisterMovable(VmaAllocation allocation, VkBuffer* buffer, const VkBufferCreateInfo& createInfo, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+	static void RegisterMovable(VmaAllocation allocation, VkImage* image, VkImageView* view, const VkImageCreateInfo& createInfo, const VkImageViewCreateInfo& viewInfo, VkImageLayout layout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+
+	// Call before handing the allocation to the deletion queue, the owner's handles are about to go away
+	static void UnregisterMovable(VmaAllocation allocation);
+
+	// Starts a defragmentation right away instead of waiting for the periodic fragmentation check
+	static void Defragment();
+	// Call once per frame, after the fence of the frame has been waited on
+	static void UpdateDefragmentation();
+
+	// Cheap, only reads counters
+	static AllocatorStats GetStats();
+	// Expensive, queries the heap budgets and walks all VMA blocks
+	static std::string GetStatsJson();
+	static void DumpStats(const std::filesystem::path& filepath);
+
+	static const char* GetCategoryName(AllocationCategory category);
 
 	static void Init();
 	static void Destroy();
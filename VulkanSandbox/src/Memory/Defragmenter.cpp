@@ -0,0 +1,406 @@
+#include "Defragmenter.h"
+
+#include "Application.h"
+
+#include <algorithm>
+
+Defragmenter::Defragmenter(VmaAllocator allocator)
+	: m_allocator(allocator)
+{}
+
+Defragmenter::~Defragmenter()
+{
+	// Only called after the device went idle, everything that is left can be finished right away
+	if (m_passActive)
+		EndPass();
+
+	if (m_context)
+		End();
+}
+
+void Defragmenter::RegisterBuffer(VmaAllocation allocation, VkBuffer* buffer, const VkBufferCreateInfo& createInfo, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MovableBuffer movable{};
+	movable.Buffer = buffer;
+	movable.CreateInfo = createInfo;
+	movable.CreateInfo.pNext = nullptr;
+	movable.DstAccess = dstAccess;
+	movable.DstStage = dstStage;
+
+	m_buffers[allocation] = movable;
+}
+
+void Defragmenter::RegisterImage(VmaAllocation allocation, VkImage* image, VkImageView* view, const VkImageCreateInfo& createInfo, const VkImageViewCreateInfo& viewInfo, VkImageLayout layout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MovableImage movable{};
+	movable.Image = image;
+	movable.View = view;
+	movable.CreateInfo = createInfo;
+	movable.CreateInfo.pNext = nullptr;
+	movable.ViewInfo = viewInfo;
+	movable.ViewInfo.pNext = nullptr;
+	movable.Layout = layout;
+	movable.DstAccess = dstAccess;
+	movable.DstStage = dstStage;
+
+	m_images[allocation] = movable;
+}
+
+void Defragmenter::Unregister(VmaAllocation allocation)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_buffers.erase(allocation);
+	m_images.erase(allocation);
+}
+
+bool Defragmenter::OnFreeBuffer(VmaAllocation allocation, VkBuffer buffer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_buffers.erase(allocation);
+
+	// Allocations that are part of a pass can't be freed directly, VMA releases them when the pass ends
+	VmaDefragmentationMove* move = FindMove(allocation);
+	if (!move)
+		return false;
+
+	move->operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+	m_retiredBuffers.push_back(buffer);
+
+	return true;
+}
+
+bool Defragmenter::OnFreeImage(VmaAllocation allocation, VkImage image)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_images.erase(allocation);
+
+	VmaDefragmentationMove* move = FindMove(allocation);
+	if (!move)
+		return false;
+
+	move->operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+	m_retiredImages.push_back(image);
+
+	return true;
+}
+
+void Defragmenter::Begin()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	StartDefragmentation();
+}
+
+void Defragmenter::Update()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_context)
+	{
+		if (++m_framesSinceCheck < VulkanConfig::DefragmentationCheckInterval)
+			return;
+
+		m_framesSinceCheck = 0;
+		if (!ShouldDefragment())
+			return;
+
+		StartDefragmentation();
+	}
+
+	if (!m_passActive)
+	{
+		BeginPass();
+		return;
+	}
+
+	// Frames recorded before the handles were swapped may still be reading the old resources
+	m_framesSincePass++;
+	if (m_framesSincePass < VulkanConfig::MaxFramesInFlight || !Application::Get().GetUploadContext()->IsComplete(m_passTicket))
+		return;
+
+	EndPass();
+}
+
+void Defragmenter::StartDefragmentation()
+{
+	if (m_context)
+		return;
+
+	VmaDefragmentationInfo defragmentationInfo{};
+	defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+	defragmentationInfo.maxBytesPerPass = VulkanConfig::DefragmentationMaxBytesPerPass;
+	defragmentationInfo.maxAllocationsPerPass = VulkanConfig::DefragmentationMaxMovesPerPass;
+
+	VK_CHECK(vmaBeginDefragmentation(m_allocator, &defragmentationInfo, &m_context), "Failed to begin defragmentation!");
+
+	LOG("[GPU] Defragmentation started");
+}
+
+void Defragmenter::BeginPass()
+{
+	VkResult result = vmaBeginDefragmentationPass(m_allocator, m_context, &m_pass);
+	if (result == VK_SUCCESS)
+	{
+		// Nothing left to move
+		End();
+		return;
+	}
+
+	VkDevice device = Application::Get().GetDevice()->GetNativeDevice();
+
+	struct BufferMove
+	{
+		VkBuffer Src;
+		VkBuffer Dst;
+		const MovableBuffer* Movable;
+	};
+
+	struct ImageMove
+	{
+		VkImage Src;
+		VkImage Dst;
+		const MovableImage* Movable;
+	};
+
+	std::vector<BufferMove> bufferMoves;
+	std::vector<ImageMove> imageMoves;
+
+	for (uint32_t i = 0; i < m_pass.moveCount; i++)
+	{
+		VmaDefragmentationMove& move = m_pass.pMoves[i];
+
+		if (auto it = m_buffers.find(move.srcAllocation); it != m_buffers.end())
+		{
+			MovableBuffer& movable = it->second;
+
+			VkBuffer buffer;
+			VK_CHECK(vkCreateBuffer(device, &movable.CreateInfo, nullptr, &buffer), "Failed to create buffer for defragmentation!");
+			VK_CHECK(vmaBindBufferMemory(m_allocator, move.dstTmpAllocation, buffer), "Failed to bind buffer for defragmentation!");
+
+			bufferMoves.push_back({ *movable.Buffer, buffer, &movable });
+		} else if (auto it = m_images.find(move.srcAllocation); it != m_images.end())
+		{
+			MovableImage& movable = it->second;
+
+			VkImage image;
+			VK_CHECK(vkCreateImage(device, &movable.CreateInfo, nullptr, &image), "Failed to create image for defragmentation!");
+			VK_CHECK(vmaBindImageMemory(m_allocator, move.dstTmpAllocation, image), "Failed to bind image for defragmentation!");
+
+			imageMoves.push_back({ *movable.Image, image, &movable });
+		} else
+		{
+			// Not registered as movable (mapped, per frame or staging memory)
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+		}
+	}
+
+	m_passActive = true;
+	m_framesSincePass = 0;
+
+	if (bufferMoves.empty() && imageMoves.empty())
+	{
+		EndPass();
+		return;
+	}
+
+	m_passTicket = Application::Get().GetUploadContext()->RecordGraphics([&](VkCommandBuffer commandBuffer)
+	{
+		// The destination memory may have been used by resources that were freed just before
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (const auto& move : imageMoves)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange = move.Movable->ViewInfo.subresourceRange;
+			barrier.subresourceRange.levelCount = move.Movable->CreateInfo.mipLevels;
+			barrier.subresourceRange.layerCount = move.Movable->CreateInfo.arrayLayers;
+
+			barrier.image = move.Src;
+			barrier.oldLayout = move.Movable->Layout;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = move.Movable->DstAccess;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barriers.push_back(barrier);
+
+			barrier.image = move.Dst;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers.push_back(barrier);
+		}
+
+		VkMemoryBarrier memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+
+		for (const auto& move : bufferMoves)
+		{
+			VkBufferCopy copyRegion{};
+			copyRegion.size = move.Movable->CreateInfo.size;
+
+			vkCmdCopyBuffer(commandBuffer, move.Src, move.Dst, 1, &copyRegion);
+		}
+
+		for (const auto& move : imageMoves)
+		{
+			const VkImageCreateInfo& createInfo = move.Movable->CreateInfo;
+
+			std::vector<VkImageCopy> copyRegions;
+			for (uint32_t mip = 0; mip < createInfo.mipLevels; mip++)
+			{
+				VkImageCopy copyRegion{};
+				copyRegion.srcSubresource.aspectMask = move.Movable->ViewInfo.subresourceRange.aspectMask;
+				copyRegion.srcSubresource.mipLevel = mip;
+				copyRegion.srcSubresource.baseArrayLayer = 0;
+				copyRegion.srcSubresource.layerCount = createInfo.arrayLayers;
+				copyRegion.dstSubresource = copyRegion.srcSubresource;
+				copyRegion.extent.width = std::max(createInfo.extent.width >> mip, 1u);
+				copyRegion.extent.height = std::max(createInfo.extent.height >> mip, 1u);
+				copyRegion.extent.depth = std::max(createInfo.extent.depth >> mip, 1u);
+				copyRegions.push_back(copyRegion);
+			}
+
+			vkCmdCopyImage(commandBuffer, move.Src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.Dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copyRegions.size(), copyRegions.data());
+		}
+
+		// Make the copies visible to the frames that use the new resources
+		VkAccessFlags dstAccess = 0;
+		VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		for (const auto& move : bufferMoves)
+		{
+			dstAccess |= move.Movable->DstAccess;
+			dstStage |= move.Movable->DstStage;
+		}
+
+		barriers.clear();
+		for (const auto& move : imageMoves)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.subresourceRange = move.Movable->ViewInfo.subresourceRange;
+			barrier.subresourceRange.levelCount = move.Movable->CreateInfo.mipLevels;
+			barrier.subresourceRange.layerCount = move.Movable->CreateInfo.arrayLayers;
+			barrier.image = move.Dst;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = move.Movable->Layout;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = move.Movable->DstAccess;
+			barriers.push_back(barrier);
+
+			dstStage |= move.Movable->DstStage;
+		}
+
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 1, &memoryBarrier, 0, nullptr, (uint32_t)barriers.size(), barriers.data());
+	});
+
+	// Frames recorded from here on use the new resources, the old ones are destroyed when the pass ends
+	for (const auto& move : bufferMoves)
+	{
+		m_retiredBuffers.push_back(move.Src);
+		*move.Movable->Buffer = move.Dst;
+	}
+
+	for (const auto& move : imageMoves)
+	{
+		VkImageViewCreateInfo viewInfo = move.Movable->ViewInfo;
+		viewInfo.image = move.Dst;
+
+		VkImageView view;
+		VK_CHECK(vkCreateImageView(device, &viewInfo, nullptr, &view), "Failed to create image view for defragmentation!");
+
+		m_retiredImages.push_back(move.Src);
+		m_retiredViews.push_back(*move.Movable->View);
+		*move.Movable->Image = move.Dst;
+		*move.Movable->View = view;
+	}
+}
+
+void Defragmenter::EndPass()
+{
+	DestroyRetired();
+
+	VkResult result = vmaEndDefragmentationPass(m_allocator, m_context, &m_pass);
+	m_passActive = false;
+	m_pass = {};
+
+	if (result == VK_SUCCESS)
+		End();
+}
+
+void Defragmenter::End()
+{
+	VmaDefragmentationStats stats{};
+	vmaEndDefragmentation(m_allocator, m_context, &stats);
+	m_context = VK_NULL_HANDLE;
+
+	m_lastStats.BytesMoved = stats.bytesMoved;
+	m_lastStats.BytesFreed = stats.bytesFreed;
+	m_lastStats.AllocationsMoved = stats.allocationsMoved;
+	m_lastStats.BlocksFreed = stats.deviceMemoryBlocksFreed;
+	m_bytesReclaimed += stats.bytesFreed;
+
+	LOG("[GPU] Defragmentation finished, moved " << stats.allocationsMoved << " allocations (" << stats.bytesMoved << " bytes), reclaimed " << stats.bytesFreed << " bytes in " << stats.deviceMemoryBlocksFreed << " blocks");
+}
+
+bool Defragmenter::ShouldDefragment()
+{
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+	vmaGetHeapBudgets(m_allocator, budgets);
+
+	VkDeviceSize blockBytes = 0;
+	VkDeviceSize allocationBytes = 0;
+	for (const auto& budget : budgets)
+	{
+		blockBytes += budget.statistics.blockBytes;
+		allocationBytes += budget.statistics.allocationBytes;
+	}
+
+	// Worth it once a quarter of the device memory we hold is unused
+	VkDeviceSize unusedBytes = blockBytes - allocationBytes;
+	return unusedBytes >= VulkanConfig::DefragmentationMinUnusedBytes && unusedBytes * 4 >= blockBytes;
+}
+
+VmaDefragmentationMove* Defragmenter::FindMove(VmaAllocation allocation)
+{
+	if (!m_passActive)
+		return nullptr;
+
+	for (uint32_t i = 0; i < m_pass.moveCount; i++)
+		if (m_pass.pMoves[i].srcAllocation == allocation)
+			return &m_pass.pMoves[i];
+
+	return nullptr;
+}
+
+void Defragmenter::DestroyRetired()
+{
+	VkDevice device = Application::Get().GetDevice()->GetNativeDevice();
+
+	for (VkImageView view : m_retiredViews)
+		vkDestroyImageView(device, view, nullptr);
+	for (VkImage image : m_retiredImages)
+		vkDestroyImage(device, image, nullptr);
+	for (VkBuffer buffer : m_retiredBuffers)
+		vkDestroyBuffer(device, buffer, nullptr);
+
+	m_retiredViews.clear();
+	m_retiredImages.clear();
+	m_retiredBuffers.clear();
+}
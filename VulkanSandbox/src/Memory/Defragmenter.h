@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Vma.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct DefragmentationStats
+{
+	uint64_t BytesMoved = 0;
+	uint64_t BytesFreed = 0;
+	uint32_t AllocationsMoved = 0;
+	uint32_t BlocksFreed = 0;
+};
+
+// Incremental defragmentation on top of the VMA defragmentation API. Every frame at most one pass
+// with a bounded number of moves is started. The copies are recorded into the upload context, the
+// owner's handles are swapped right away and the old handles are destroyed once the copies and all
+// frames that could still reference them have completed.
+//
+// Only allocations registered with RegisterBuffer() / RegisterImage() can be moved, the handle
+// pointers have to stay valid until the allocation is freed.
+class Defragmenter
+{
+public:
+	Defragmenter(VmaAllocator allocator);
+	~Defragmenter();
+
+	void RegisterBuffer(VmaAllocation allocation, VkBuffer* buffer, const VkBufferCreateInfo& createInfo, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+	void RegisterImage(VmaAllocation allocation, VkImage* image, VkImageView* view, const VkImageCreateInfo& createInfo, const VkImageViewCreateInfo& viewInfo, VkImageLayout layout, VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+
+	void Unregister(VmaAllocation allocation);
+
+	// Returns true when the allocation is being moved by the current pass, it and the given handle are then released by the defragmenter
+	bool OnFreeBuffer(VmaAllocation allocation, VkBuffer buffer);
+	bool OnFreeImage(VmaAllocation allocation, VkImage image);
+
+	void Begin();
+	// Call once per frame, after the fence of the frame has been waited on
+	void Update();
+
+	bool IsRunning() const { return m_context != VK_NULL_HANDLE; }
+	uint64_t GetBytesReclaimed() const { return m_bytesReclaimed; }
+	const DefragmentationStats& GetLastStats() const { return m_lastStats; }
+
+private:
+	struct MovableBuffer
+	{
+		VkBuffer* Buffer;
+		VkBufferCreateInfo CreateInfo;
+		VkAccessFlags DstAccess;
+		VkPipelineStageFlags DstStage;
+	};
+
+	struct MovableImage
+	{
+		VkImage* Image;
+		VkImageView* View;
+		VkImageCreateInfo CreateInfo;
+		VkImageViewCreateInfo ViewInfo;
+		VkImageLayout Layout;
+		VkAccessFlags DstAccess;
+		VkPipelineStageFlags DstStage;
+	};
+
+	void StartDefragmentation();
+	void BeginPass();
+	void EndPass();
+	void End();
+
+	bool ShouldDefragment();
+	VmaDefragmentationMove* FindMove(VmaAllocation allocation);
+	void DestroyRetired();
+
+private:
+	VmaAllocator m_allocator;
+	VmaDefragmentationContext m_context = VK_NULL_HANDLE;
+
+	std::unordered_map<VmaAllocation, MovableBuffer> m_buffers;
+	std::unordered_map<VmaAllocation, MovableImage> m_images;
+
+	bool m_passActive = false;
+	VmaDefragmentationPassMoveInfo m_pass{};
+	uint64_t m_passTicket = 0;
+	uint32_t m_framesSincePass = 0;
+	uint32_t m_framesSinceCheck = 0;
+
+	// Destroyed when the current pass ends
+	std::vector<VkBuffer> m_retiredBuffers;
+	std::vector<VkImage> m_retiredImages;
+	std::vector<VkImageView> m_retiredViews;
+
+	std::atomic<uint64_t> m_bytesReclaimed = 0;
+	DefragmentationStats m_lastStats;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
@@ -1,20 +1,135 @@
 #include "DeletionCommandQueue.h"
 
+#include "Application.h"
+
 DeletionCommandQueue DeletionCommandQueue::s_instance;
 
-void DeletionCommandQueue::AddCommand(DeleteCommand fn)
+DeletionCommandQueue::DeletionCommandQueue()
+{
+	// Sized for the limit, the frame count isn't known yet when this is constructed
+	m_frames.resize(VulkanConfig::MaxFramesInFlightLimit + 1);
+}
+
+void DeletionCommandQueue::DestroyBuffer(VkBuffer buffer, VmaAllocation allocation)
+{
+	DeleteCommand command{ DeleteType::Buffer, (uint64_t)buffer };
+	command.Allocation = allocation;
+	Get().Push(command);
+}
+
+void DeletionCommandQueue::DestroyImage(VkImage image, VmaAllocation allocation)
+{
+	DeleteCommand command{ DeleteType::Image, (uint64_t)image };
+	command.Allocation = allocation;
+	Get().Push(command);
+}
+
+void DeletionCommandQueue::DestroyImageView(VkImageView imageView)
+{
+	Get().Push({ DeleteType::ImageView, (uint64_t)imageView });
+}
+
+void DeletionCommandQueue::DestroySampler(VkSampler sampler)
+{
+	Get().Push({ DeleteType::Sampler, (uint64_t)sampler });
+}
+
+void DeletionCommandQueue::DestroyFramebuffer(VkFramebuffer framebuffer)
+{
+	Get().Push({ DeleteType::Framebuffer, (uint64_t)framebuffer });
+}
+
+void DeletionCommandQueue::DestroyRenderPass(VkRenderPass renderPass)
+{
+	Get().Push({ DeleteType::RenderPass, (uint64_t)renderPass });
+}
+
+void DeletionCommandQueue::DestroySwapchain(VkSwapchainKHR swapchain)
+{
+	Get().Push({ DeleteType::Swapchain, (uint64_t)swapchain });
+}
+
+void DeletionCommandQueue::DestroySemaphore(VkSemaphore semaphore)
+{
+	Get().Push({ DeleteType::Semaphore, (uint64_t)semaphore });
+}
+
+void DeletionCommandQueue::DestroyFence(VkFence fence)
 {
-	Get().m_commandQueue.push_back(fn);
-	Get().m_commandCount++;
+	Get().Push({ DeleteType::Fence, (uint64_t)fence });
+}
+
+void DeletionCommandQueue::AddCommand(DeleteFn fn, void* userData)
+{
+	DeleteCommand command{ DeleteType::Callback };
+	command.Callback = fn;
+	command.UserData = userData;
+	Get().Push(command);
 }
 
 void DeletionCommandQueue::Execute()
 {
-	for (uint32_t i = 0; i < Get().m_commandCount; i++)
+	auto& queue = Get();
+
+	{
+		std::lock_guard<std::mutex> lock(queue.m_mutex);
+
+		// The fence that was just waited on belongs to the frame MaxFramesInFlight frames ago
+		queue.m_frameNumber++;
+		auto& frame = queue.m_frames[(queue.m_frameNumber + queue.m_frames.size() - VulkanConfig::MaxFramesInFlight) % queue.m_frames.size()];
+
+		// Swap instead of move so both vectors keep their capacity
+		queue.m_executing.clear();
+		queue.m_executing.swap(frame);
+	}
+
+	queue.Run(queue.m_executing);
+}
+
+void DeletionCommandQueue::Flush()
+{
+	auto& queue = Get();
+
+	// Oldest first, in the order they were enqueued
+	for (size_t i = 1; i <= queue.m_frames.size(); i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+
+			queue.m_executing.clear();
+			queue.m_executing.swap(queue.m_frames[(queue.m_frameNumber + i) % queue.m_frames.size()]);
+		}
+
+		queue.Run(queue.m_executing);
+	}
+}
+
+void DeletionCommandQueue::Push(const DeleteCommand& command)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_frames[m_frameNumber % m_frames.size()].push_back(command);
+}
+
+void DeletionCommandQueue::Run(std::vector<DeleteCommand>& commands)
+{
+	VkDevice device = Application::Get().GetDevice()->GetNativeDevice();
+
+	for (const auto& command : commands)
 	{
-		Get().m_commandQueue.back()();
-		Get().m_commandQueue.pop_back();
+		switch (command.Type)
+		{
+			case DeleteType::Buffer: Allocator::DestroyBuffer((VkBuffer)command.Handle, command.Allocation); break;
+			case DeleteType::Image: Allocator::DestroyImage((VkImage)command.Handle, command.Allocation); break;
+			case DeleteType::ImageView: vkDestroyImageView(device, (VkImageView)command.Handle, nullptr); break;
+			case DeleteType::Sampler: vkDestroySampler(device, (VkSampler)command.Handle, nullptr); break;
+			case DeleteType::Framebuffer: vkDestroyFramebuffer(device, (VkFramebuffer)command.Handle, nullptr); break;
+			case DeleteType::RenderPass: vkDestroyRenderPass(device, (VkRenderPass)command.Handle, nullptr); break;
+			case DeleteType::Swapchain: vkDestroySwapchainKHR(device, (VkSwapchainKHR)command.Handle, nullptr); break;
+			case DeleteType::Semaphore: vkDestroySemaphore(device, (VkSemaphore)command.Handle, nullptr); break;
+			case DeleteType::Fence: vkDestroyFence(device, (VkFence)command.Handle, nullptr); break;
+			case DeleteType::Callback: command.Callback(command.UserData); break;
+		}
 	}
 
-	Get().m_commandCount = 0;
+	commands.clear();
 }
@@ -1,10 +1,40 @@
 #pragma once
 
-#include <deque>
-#include <functional>
+#include "Vma.h"
 
-using DeleteCommand = std::function<void()>;
+#include <mutex>
+#include <vector>
 
+using DeleteFn = void(*)(void* userData);
+
+enum class DeleteType : uint8_t
+{
+	Buffer = 0,
+	Image,
+	ImageView,
+	Sampler,
+	Framebuffer,
+	RenderPass,
+	Swapchain,
+	Semaphore,
+	Fence,
+	Callback
+};
+
+// Typed handle instead of a closure, so enqueueing never allocates
+struct DeleteCommand
+{
+	DeleteType Type;
+	uint64_t Handle = 0;
+	VmaAllocation Allocation = VK_NULL_HANDLE;
+
+	DeleteFn Callback = nullptr;
+	void* UserData = nullptr;
+};
+
+// Deferred destruction of GPU objects. Commands are collected per frame and run once the fence of
+// the frame they were enqueued in has signalled, so nothing is destroyed while a frame in flight
+// may still use it. Safe to enqueue from any thread.
 class DeletionCommandQueue
 {
 public:
@@ -12,16 +42,36 @@ public:
 	DeletionCommandQueue(const DeletionCommandQueue&) = delete;
 	DeletionCommandQueue& operator=(const DeletionCommandQueue&) = delete;
 
-	static void AddCommand(DeleteCommand fn);
+	static void DestroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+	static void DestroyImage(VkImage image, VmaAllocation allocation);
+	static void DestroyImageView(VkImageView imageView);
+	static void DestroySampler(VkSampler sampler);
+	static void DestroyFramebuffer(VkFramebuffer framebuffer);
+	static void DestroyRenderPass(VkRenderPass renderPass);
+	static void DestroySwapchain(VkSwapchainKHR swapchain);
+	static void DestroySemaphore(VkSemaphore semaphore);
+	static void DestroyFence(VkFence fence);
+	static void AddCommand(DeleteFn fn, void* userData);
+
+	// Call once per frame, right after the fence of the frame has been waited on
 	static void Execute();
+	// Runs everything that is queued, the device has to be idle
+	static void Flush();
 
 	static DeletionCommandQueue& Get() { return s_instance; }
 
 private:
-	DeletionCommandQueue() = default;
+	DeletionCommandQueue();
+
+	void Push(const DeleteCommand& command);
+	void Run(std::vector<DeleteCommand>& commands);
+
+	// One slot per frame in flight plus the one being recorded, unused ones stay empty
+	std::vector<std::vector<DeleteCommand>> m_frames;
+	std::vector<DeleteCommand> m_executing;
+	uint64_t m_frameNumber = 0;
 
-	std::deque<DeleteCommand> m_commandQueue;
-	uint32_t m_commandCount = 0;
+	std::mutex m_mutex;
 
 	static DeletionCommandQueue s_instance;
 };
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& filepath)
+{
+	HANDLE file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	m_data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return;
+	}
+
+	m_size = (size_t)size.QuadPart;
+	m_file = file;
+	m_mapping = mapping;
+}
+
+MappedFile::~MappedFile()
+{
+	if (!m_data)
+		return;
+
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& filepath)
+{
+	int file = open(filepath.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		close(file);
+		return;
+	}
+
+	void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+	// The mapping keeps its own reference to the file
+	close(file);
+
+	if (data == MAP_FAILED)
+		return;
+
+	// Everything gets copied out right away, start reading ahead of the first touch
+	madvise(data, (size_t)status.st_size, MADV_WILLNEED);
+
+	m_data = (const uint8_t*)data;
+	m_size = (size_t)status.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		munmap((void*)m_data, m_size);
+}
+
+#endif
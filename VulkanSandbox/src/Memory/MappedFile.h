@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// Read only mapping of a whole file. Pages are only read from disk when they are touched, so copying out of
+// the mapping replaces both the read and the intermediate buffer.
+class MappedFile
+{
+public:
+	MappedFile(const std::filesystem::path& filepath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsValid() const { return m_data != nullptr; }
+
+	const uint8_t* GetData() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
\ No newline at end of file
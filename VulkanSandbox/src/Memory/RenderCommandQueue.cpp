@@ -1,20 +1,66 @@
 #include "RenderCommandQueue.h"
 
+#include "Vulkan.h"
+
 RenderCommandQueue RenderCommandQueue::s_instance;
 
-void RenderCommandQueue::AddCommand(RenderCommand fn)
+static uintptr_t AlignUp(uintptr_t value, uintptr_t alignment)
 {
-	Get().m_commandQueue.push(fn);
-	Get().m_commandCount++;
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+RenderCommandQueue::RenderCommandQueue()
+	: m_capacity(VulkanConfig::RenderCommandQueueSize)
+{
+	for (auto& arena : m_arenas)
+		arena.Buffer = std::make_unique<uint8_t[]>(m_capacity);
 }
 
 void RenderCommandQueue::Execute()
 {
-	for (uint32_t i = 0; i < Get().m_commandCount; i++)
+	auto& queue = Get();
+	Arena& arena = queue.m_arenas[queue.m_submitIndex ^ 1];
+
+	uint8_t* buffer = arena.Buffer.get();
+	uint32_t offset = 0;
+
+	while (offset < arena.Offset)
 	{
-		Get().m_commandQueue.front()();
-		Get().m_commandQueue.pop();
+		CommandHeader* header = (CommandHeader*)(buffer + offset);
+		header->Fn(buffer + offset + header->DataOffset);
+		offset += header->Size;
 	}
 
-	Get().m_commandCount = 0;
+	arena.Offset = 0;
+	arena.CommandCount = 0;
+}
+
+void RenderCommandQueue::SwapQueues()
+{
+	auto& queue = Get();
+	queue.m_submitIndex ^= 1;
+}
+
+void* RenderCommandQueue::Allocate(RenderCommandFn fn, uint32_t size, uint32_t alignment)
+{
+	Arena& arena = m_arenas[m_submitIndex];
+
+	// Work on addresses, the alignment of a capture can exceed the one of the buffer
+	uintptr_t base = (uintptr_t)arena.Buffer.get();
+	uintptr_t header = AlignUp(base + arena.Offset, alignof(CommandHeader));
+	uintptr_t data = AlignUp(header + sizeof(CommandHeader), alignment);
+	uintptr_t end = AlignUp(data + size, alignof(CommandHeader));
+
+	if (end - base > m_capacity)
+		throw std::runtime_error("Render command queue is full, raise VulkanConfig::RenderCommandQueueSize!");
+
+	CommandHeader* commandHeader = (CommandHeader*)header;
+	commandHeader->Fn = fn;
+	commandHeader->DataOffset = (uint32_t)(data - header);
+	commandHeader->Size = (uint32_t)(end - header);
+
+	arena.Offset = (uint32_t)(end - base);
+	arena.CommandCount++;
+
+	return (void*)data;
 }
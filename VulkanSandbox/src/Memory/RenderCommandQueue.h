@@ -1,10 +1,20 @@
 #pragma once
 
-#include <functional>
-#include <queue>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-using RenderCommand = std::function<void()>;
+using RenderCommandFn = void(*)(void* data);
 
+// Commands are placement-constructed back to back in a byte arena: a small header with the function
+// pointer followed by the captured data. Nothing is allocated per command and execution walks the
+// arena front to back.
+//
+// Double buffered: one thread fills the submission arena with Submit() while the render thread
+// drains the other one with Execute(). SwapQueues() flips them and must be called while neither
+// side is busy, once per frame. Submit() itself is meant for a single producer thread.
 class RenderCommandQueue
 {
 public:
@@ -12,16 +22,55 @@ public:
 	RenderCommandQueue(const RenderCommandQueue&) = delete;
 	RenderCommandQueue& operator=(const RenderCommandQueue&) = delete;
 
-	static void AddCommand(RenderCommand fn);
+	template<typename Fn>
+	static void Submit(Fn&& fn)
+	{
+		using Command = std::decay_t<Fn>;
+
+		// Runs the command and destroys its captured data in place
+		RenderCommandFn execute = [](void* data)
+		{
+			Command* command = (Command*)data;
+			(*command)();
+			command->~Command();
+		};
+
+		void* storage = Get().Allocate(execute, (uint32_t)sizeof(Command), (uint32_t)alignof(Command));
+		new (storage) Command(std::forward<Fn>(fn));
+	}
+
+	// Runs and clears the render side
 	static void Execute();
+	// Hands the submitted commands to the render side
+	static void SwapQueues();
+
+	static uint32_t GetSubmittedCount() { return Get().m_arenas[Get().m_submitIndex].CommandCount; }
 
 	static RenderCommandQueue& Get() { return s_instance; }
 
 private:
-	RenderCommandQueue() = default;
+	RenderCommandQueue();
+
+	void* Allocate(RenderCommandFn fn, uint32_t size, uint32_t alignment);
+
+private:
+	struct CommandHeader
+	{
+		RenderCommandFn Fn;
+		uint32_t DataOffset; // From the start of the header
+		uint32_t Size; // Up to the next header
+	};
+
+	struct Arena
+	{
+		std::unique_ptr<uint8_t[]> Buffer;
+		uint32_t Offset = 0;
+		uint32_t CommandCount = 0;
+	};
 
-	std::queue<RenderCommand> m_commandQueue;
-	uint32_t m_commandCount = 0;
+	Arena m_arenas[2];
+	uint32_t m_capacity;
+	uint32_t m_submitIndex = 0;
 
 	static RenderCommandQueue s_instance;
 };
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "StagingRing.h"
+
+#include "Allocator.h"
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+
+// Satisfies bufferOffset requirements for copies of every format we upload (texel/block size <= 16)
+static constexpr VkDeviceSize s_alignment = 16;
+
+// Large meshes and textures are copied in chunks on the job system, below this a single memcpy wins
+static constexpr VkDeviceSize s_parallelCopyChunkSize = 1024 * 1024;
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void Copy(uint8_t* dst, const uint8_t* src, VkDeviceSize size)
+{
+	uint32_t chunkCount = (uint32_t)((size + s_parallelCopyChunkSize - 1) / s_parallelCopyChunkSize);
+
+	JobSystem::ParallelFor(chunkCount, 2, [&](uint32_t begin, uint32_t end)
+	{
+		VkDeviceSize offset = begin * s_parallelCopyChunkSize;
+		VkDeviceSize chunkEnd = std::min(end * s_parallelCopyChunkSize, size);
+		memcpy(dst + offset, src + offset, (size_t)(chunkEnd - offset));
+	});
+}
+
+StagingRing::StagingRing(VkDeviceSize size)
+	: m_size(size)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	m_allocation = Allocator::AllocateBuffer(m_buffer, bufferInfo, AllocationCategory::Staging, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	m_data = (uint8_t*)Allocator::GetMappedData(m_allocation);
+}
+
+StagingRing::~StagingRing()
+{
+	Allocator::DestroyBuffer(m_buffer, m_allocation);
+}
+
+StagingAllocation StagingRing::Allocate(const void* data, VkDeviceSize size)
+{
+	StagingAllocation allocation;
+	VkDeviceSize offset = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (size <= m_size && TryAllocate(size, offset))
+		{
+			allocation.Buffer = m_buffer;
+			allocation.Offset = offset;
+			allocation.Size = size;
+			allocation.Data = m_data + offset;
+		}
+	}
+
+	// Either larger than the ring or the GPU still holds on to too much of it
+	if (!allocation.Buffer)
+		allocation = AllocateDedicated(size);
+
+	if (data)
+		Copy((uint8_t*)allocation.Data, (const uint8_t*)data, size);
+	else
+		memset(allocation.Data, 0, (size_t)size);
+
+	if (allocation.DedicatedAllocation)
+		Allocator::FlushMemory(allocation.DedicatedAllocation, 0, size);
+	else
+		Allocator::FlushMemory(m_allocation, allocation.Offset, size);
+
+	return allocation;
+}
+
+void StagingRing::Free(const StagingAllocation& allocation)
+{
+	if (allocation.DedicatedAllocation)
+	{
+		Allocator::DestroyBuffer(allocation.Buffer, allocation.DedicatedAllocation);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& region : m_regions)
+	{
+		if (region.Offset == allocation.Offset && !region.Freed)
+		{
+			region.Freed = true;
+			break;
+		}
+	}
+
+	// Regions are consumed in submission order, so only the front moves the tail forward
+	while (!m_regions.empty() && m_regions.front().Freed)
+		m_regions.pop_front();
+}
+
+bool StagingRing::TryAllocate(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (m_regions.empty())
+	{
+		m_head = 0;
+		offset = 0;
+	} else
+	{
+		VkDeviceSize tail = m_regions.front().Offset;
+		offset = AlignUp(m_head, s_alignment);
+
+		if (m_head > tail)
+		{
+			// Used space is [tail, head), free space is at the end and in front of the tail
+			if (offset + size > m_size)
+			{
+				if (size > tail)
+					return false;
+
+				// Pad out the end so the tail can walk over it once everything before it is freed
+				m_regions.push_back({ m_head, m_size - m_head, true });
+				offset = 0;
+			}
+		} else
+		{
+			// Used space wrapped around, the only free space is [head, tail)
+			if (offset + size > tail)
+				return false;
+		}
+	}
+
+	m_regions.push_back({ offset, size, false });
+	m_head = offset + size;
+
+	return true;
+}
+
+StagingAllocation StagingRing::AllocateDedicated(VkDeviceSize size)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	StagingAllocation allocation;
+	allocation.DedicatedAllocation = Allocator::AllocateBuffer(allocation.Buffer, bufferInfo, AllocationCategory::Staging, VMA_MEMORY_USAGE_AUTO, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+	allocation.Data = Allocator::GetMappedData(allocation.DedicatedAllocation);
+	allocation.Size = size;
+
+	return allocation;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Vma.h"
+
+#include <deque>
+#include <mutex>
+
+struct StagingAllocation
+{
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* Data = nullptr;
+
+	// Only set when the upload did not fit in the ring and got its own buffer
+	VmaAllocation DedicatedAllocation = VK_NULL_HANDLE;
+};
+
+// Persistently mapped staging buffer that is handed out front to back. Regions have to be freed
+// once the GPU has consumed them, the ring wraps around as soon as the oldest regions are freed.
+class StagingRing
+{
+public:
+	StagingRing(VkDeviceSize size);
+	~StagingRing();
+
+	StagingAllocation Allocate(const void* data, VkDeviceSize size);
+	void Free(const StagingAllocation& allocation);
+
+	VkDeviceSize GetSize() const { return m_size; }
+
+private:
+	bool TryAllocate(VkDeviceSize size, VkDeviceSize& offset);
+	StagingAllocation AllocateDedicated(VkDeviceSize size);
+
+private:
+	struct Region
+	{
+		VkDeviceSize Offset;
+		VkDeviceSize Size;
+		bool Freed;
+	};
+
+	VkBuffer m_buffer;
+	VmaAllocation m_allocation;
+	uint8_t* m_data = nullptr;
+	VkDeviceSize m_size;
+
+	VkDeviceSize m_head = 0;
+	std::deque<Region> m_regions;
+
+	std::mutex m_mutex;
+};
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "ParallelRecorder.h"
+
+#include "Jobs/JobSystem.h"
+
+#include <algorithm>
+
+ParallelRecorder::ParallelRecorder(const std::shared_ptr<LogicalDevice>& device)
+	: m_logicalDevice(device)
+{
+	VkDevice logicalDevice = m_logicalDevice->GetNativeDevice();
+
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolInfo.queueFamilyIndex = m_logicalDevice->GetPhysicalDevice()->GetQueueFamilyIndices().Graphics;
+
+	// One slice per worker plus the recording thread, which helps out while it waits
+	m_slices.resize(JobSystem::GetWorkerCount() + 1);
+	for (auto& slice : m_slices)
+	{
+		slice.CommandPools.resize(VulkanConfig::MaxFramesInFlight);
+		slice.CommandBuffers.resize(VulkanConfig::MaxFramesInFlight);
+
+		for (uint32_t i = 0; i < VulkanConfig::MaxFramesInFlight; i++)
+		{
+			VK_CHECK(vkCreateCommandPool(logicalDevice, &commandPoolInfo, nullptr, &slice.CommandPools[i]), "Failed to create recording command pool!");
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = slice.CommandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VK_CHECK(vkAllocateCommandBuffers(logicalDevice, &allocInfo, &slice.CommandBuffers[i]), "Failed to allocate secondary command buffer!");
+		}
+	}
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+	VkDevice device = m_logicalDevice->GetNativeDevice();
+
+	for (auto& slice : m_slices)
+	{
+		for (VkCommandPool commandPool : slice.CommandPools)
+			vkDestroyCommandPool(device, commandPool, nullptr);
+	}
+}
+
+void ParallelRecorder::Record(VkCommandBuffer primaryCommandBuffer, uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFn& fn)
+{
+	if (drawCount == 0)
+		return;
+
+	// Slices below the minimum cost more to set up than they save
+	uint32_t sliceCount = std::min((uint32_t)m_slices.size(), (drawCount + VulkanConfig::MinDrawsPerSlice - 1) / VulkanConfig::MinDrawsPerSlice);
+	uint32_t drawsPerSlice = (drawCount + sliceCount - 1) / sliceCount;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = framebuffer;
+
+	// Each slice is a job of its own, so no two threads touch the same pool
+	JobCounter counter;
+	for (uint32_t i = 0; i < sliceCount; i++)
+	{
+		uint32_t begin = std::min(i * drawsPerSlice, drawCount);
+		uint32_t end = std::min(begin + drawsPerSlice, drawCount);
+
+		JobSystem::Run([&, i, begin, end]() { RecordSlice(i, frameIndex, begin, end, inheritanceInfo, fn); }, &counter);
+	}
+
+	JobSystem::Wait(counter);
+
+	// Executed in slice order, so the draw order of the list is kept
+	std::vector<VkCommandBuffer> commandBuffers(sliceCount);
+	for (uint32_t i = 0; i < sliceCount; i++)
+		commandBuffers[i] = m_slices[i].CommandBuffers[frameIndex];
+
+	vkCmdExecuteCommands(primaryCommandBuffer, sliceCount, commandBuffers.data());
+}
+
+void ParallelRecorder::RecordSlice(uint32_t sliceIndex, uint32_t frameIndex, uint32_t begin, uint32_t end, const VkCommandBufferInheritanceInfo& inheritanceInfo, const RecordFn& fn)
+{
+	Slice& slice = m_slices[sliceIndex];
+	VkCommandBuffer commandBuffer = slice.CommandBuffers[frameIndex];
+
+	// The frame this pool belongs to has finished, so everything recorded from it can go at once
+	vkResetCommandPool(m_logicalDevice->GetNativeDevice(), slice.CommandPools[frameIndex], 0);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin secondary command buffer!");
+	fn(commandBuffer, begin, end);
+	VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to record secondary command buffer!");
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Device/LogicalDevice.h"
+
+#include <functional>
+
+// Records a draw list on the job system. Every slice of the list owns a command pool per frame in
+// flight and is recorded into its own secondary command buffer, the primary buffer then executes
+// them in order. Secondary buffers inherit no state, so the record function has to bind everything
+// it needs (pipeline, viewport, descriptors) itself.
+class ParallelRecorder
+{
+public:
+	// Records the draws [begin, end) into the given secondary command buffer
+	using RecordFn = std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)>;
+
+	ParallelRecorder(const std::shared_ptr<LogicalDevice>& device);
+	~ParallelRecorder();
+
+	// Call inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, after the fence of the frame has been waited on
+	void Record(VkCommandBuffer primaryCommandBuffer, uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t drawCount, const RecordFn& fn);
+
+	uint32_t GetMaxSliceCount() const { return (uint32_t)m_slices.size(); }
+
+private:
+	void RecordSlice(uint32_t sliceIndex, uint32_t frameIndex, uint32_t begin, uint32_t end, const VkCommandBufferInheritanceInfo& inheritanceInfo, const RecordFn& fn);
+
+private:
+	struct Slice
+	{
+		std::vector<VkCommandPool> CommandPools; // Per frame in flight
+		std::vector<VkCommandBuffer> CommandBuffers;
+	};
+
+	std::shared_ptr<LogicalDevice> m_logicalDevice;
+	std::vector<Slice> m_slices;
+};
\ No newline at end of file
@@ -7,22 +7,22 @@ Pipeline::Pipeline(const std::shared_ptr<LogicalDevice>& device)
 	: m_logicalDevice(device)
 {
 	auto logicalDevice = m_logicalDevice->GetNativeDevice();
-	auto vertShader = ReadBytes("shaders/vert.spv");
-	auto fragShader = ReadBytes("shaders/frag.spv");
+	auto& assetManager = Application::Get().GetAssetManager();
 
-	VkShaderModule vertShaderModule = CreateShaderModule(vertShader);
-	VkShaderModule fragShaderModule = CreateShaderModule(fragShader);
+	// Only needed until the pipeline is created, after that they are left to the asset cache
+	auto vertShaderModule = assetManager->LoadShader("shaders/vert.spv");
+	auto fragShaderModule = assetManager->LoadShader("shaders/frag.spv");
 
 	VkPipelineShaderStageCreateInfo vertShaderCreateInfo{};
 	vertShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderCreateInfo.module = vertShaderModule;
+	vertShaderCreateInfo.module = vertShaderModule->GetNativeModule();
 	vertShaderCreateInfo.pName = "main";
 
 	VkPipelineShaderStageCreateInfo fragShaderCreateInfo{};
 	fragShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	fragShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderCreateInfo.module = fragShaderModule;
+	fragShaderCreateInfo.module = fragShaderModule->GetNativeModule();
 	fragShaderCreateInfo.pName = "main";
 
 	VkPipelineShaderStageCreateInfo shaderStagers[] = { vertShaderCreateInfo, fragShaderCreateInfo };
@@ -108,7 +108,7 @@ Pipeline::Pipeline(const std::shared_ptr<LogicalDevice>& device)
 	// Descriptor sets
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
 	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	uboLayoutBinding.pImmutableSamplers = nullptr;
@@ -151,15 +151,12 @@ Pipeline::Pipeline(const std::shared_ptr<LogicalDevice>& device)
 	pipelineInfo.pColorBlendState = &colorBlendInfo;
 	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = m_pipelineLayout;
-	pipelineInfo.renderPass = Application::Get().GetSwapchain()->GetRenderPass();
+	pipelineInfo.renderPass = Application::Get().GetRenderTarget()->GetRenderPass();
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
 	VK_CHECK(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline), "Failed to create graphics pipeline!");
-
-	vkDestroyShaderModule(m_logicalDevice->GetNativeDevice(), vertShaderModule, nullptr);
-	vkDestroyShaderModule(m_logicalDevice->GetNativeDevice(), fragShaderModule, nullptr);
 }
 
 void Pipeline::Destroy()
@@ -171,16 +168,3 @@ void Pipeline::Destroy()
 	vkDestroyPipeline(logicalDevice, m_pipeline, nullptr);
 	vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
 }
-
-VkShaderModule Pipeline::CreateShaderModule(const std::vector<char>& byteCode)
-{
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = byteCode.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(byteCode.data());
-
-	VkShaderModule shaderModule;
-	VK_CHECK(vkCreateShaderModule(m_logicalDevice->GetNativeDevice(), &createInfo, nullptr, &shaderModule), "Failed to create shader module!");
-
-	return shaderModule;
-}
@@ -13,9 +13,6 @@ public:
 	VkPipelineLayout GetPipelineLayout() { return m_pipelineLayout; }
 	VkDescriptorSetLayout GetDescriptorLayout() { return m_descriptorLayout; }
 
-private:
-	VkShaderModule CreateShaderModule(const std::vector<char>& byteCode);
-
 private:
 	std::shared_ptr<LogicalDevice> m_logicalDevice;
 
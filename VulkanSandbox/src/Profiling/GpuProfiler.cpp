@@ -0,0 +1,195 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+
+GpuProfiler::GpuProfiler(const std::shared_ptr<LogicalDevice>& device)
+	: m_logicalDevice(device)
+{
+	const auto& physicalDevice = m_logicalDevice->GetPhysicalDevice();
+
+	m_validBits = physicalDevice->GetTimestampValidBits(physicalDevice->GetQueueFamilyIndices().Graphics);
+	m_timestampPeriod = physicalDevice->GetDeviceProperties().limits.timestampPeriod;
+
+	if (!IsSupported())
+	{
+		LOG("Graphics queue has no timestamp support, GPU profiling is disabled");
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = VulkanConfig::GpuProfilerMaxZones * 2;
+
+	m_frames.resize(VulkanConfig::MaxFramesInFlight);
+	for (auto& frame : m_frames)
+	{
+		VK_CHECK(vkCreateQueryPool(m_logicalDevice->GetNativeDevice(), &queryPoolInfo, nullptr, &frame.QueryPool), "Failed to create timestamp query pool!");
+		frame.Zones.reserve(VulkanConfig::GpuProfilerMaxZones);
+	}
+
+	// Value and availability of every query
+	m_results.resize(VulkanConfig::GpuProfilerMaxZones * 4);
+}
+
+void GpuProfiler::Destroy()
+{
+	for (auto& frame : m_frames)
+		vkDestroyQueryPool(m_logicalDevice->GetNativeDevice(), frame.QueryPool, nullptr);
+
+	m_frames.clear();
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber)
+{
+	if (!IsSupported())
+		return;
+
+	m_frameIndex = frameIndex;
+	Frame& frame = m_frames[frameIndex];
+
+	// The fence of this frame slot has signalled, so its previous results are there
+	ReadResults(frame);
+	frame.FrameNumber = frameNumber;
+
+	vkCmdResetQueryPool(commandBuffer, frame.QueryPool, 0, VulkanConfig::GpuProfilerMaxZones * 2);
+}
+
+uint32_t GpuProfiler::BeginZone(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!IsSupported())
+		return UINT32_MAX;
+
+	Frame& frame = m_frames[m_frameIndex];
+	if (frame.Zones.size() == VulkanConfig::GpuProfilerMaxZones)
+		return UINT32_MAX;
+
+	uint32_t query = (uint32_t)frame.Zones.size() * 2;
+	frame.Zones.push_back({ name, query });
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.QueryPool, query);
+
+	return (uint32_t)frame.Zones.size() - 1;
+}
+
+void GpuProfiler::EndZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+	if (zone == UINT32_MAX)
+		return;
+
+	Frame& frame = m_frames[m_frameIndex];
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.QueryPool, frame.Zones[zone].Query + 1);
+}
+
+void GpuProfiler::AddSample(const char* name, double ms)
+{
+	AddSample(name, ms, true);
+}
+
+void GpuProfiler::AddSample(const char* name, double ms, bool record)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto it = m_history.find(name);
+	if (it == m_history.end())
+	{
+		it = m_history.emplace(name, History{}).first;
+		it->second.Samples.reserve(VulkanConfig::GpuProfilerHistory);
+		m_order.push_back(name);
+	}
+
+	History& history = it->second;
+	if (history.Samples.size() < VulkanConfig::GpuProfilerHistory)
+		history.Samples.push_back(ms);
+	else
+		history.Samples[history.Next] = ms;
+
+	history.Next = (history.Next + 1) % VulkanConfig::GpuProfilerHistory;
+
+	if (m_recording && record)
+		m_recordedSamples[name].push_back(ms);
+}
+
+double GpuProfiler::ToMilliseconds(uint64_t begin, uint64_t end, uint32_t validBits) const
+{
+	// Only the low bits are written, the counter may have wrapped in between
+	uint64_t mask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+	uint64_t ticks = (end - begin) & mask;
+
+	return ticks * (double)m_timestampPeriod / 1000000.0;
+}
+
+std::vector<GpuZoneStats> GpuProfiler::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<GpuZoneStats> stats;
+	stats.reserve(m_order.size());
+
+	for (const auto& name : m_order)
+	{
+		const History& history = m_history[name];
+
+		GpuZoneStats zone;
+		zone.Name = name;
+		zone.SampleCount = (uint32_t)history.Samples.size();
+		zone.MinMs = *std::min_element(history.Samples.begin(), history.Samples.end());
+		zone.MaxMs = *std::max_element(history.Samples.begin(), history.Samples.end());
+
+		for (double sample : history.Samples)
+			zone.AvgMs += sample;
+		zone.AvgMs /= zone.SampleCount;
+
+		stats.push_back(zone);
+	}
+
+	return stats;
+}
+
+void GpuProfiler::BeginRecording(uint64_t firstFrame)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_recordedSamples.clear();
+	m_recordingFirstFrame = firstFrame;
+	m_recording = true;
+}
+
+std::unordered_map<std::string, std::vector<double>> GpuProfiler::EndRecording()
+{
+	// The last frames in flight are only read back when their slot is reused, which never happens now
+	for (auto& frame : m_frames)
+		ReadResults(frame);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_recording = false;
+	return std::move(m_recordedSamples);
+}
+
+void GpuProfiler::ReadResults(Frame& frame)
+{
+	if (frame.Zones.empty())
+		return;
+
+	uint32_t queryCount = (uint32_t)frame.Zones.size() * 2;
+	bool record;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		record = frame.FrameNumber >= m_recordingFirstFrame;
+	}
+
+	// Zones that were never closed stay unavailable
+	vkGetQueryPoolResults(m_logicalDevice->GetNativeDevice(), frame.QueryPool, 0, queryCount, queryCount * 2 * sizeof(uint64_t), m_results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	for (const auto& zone : frame.Zones)
+	{
+		const uint64_t* begin = &m_results[zone.Query * 2];
+		const uint64_t* end = &m_results[(zone.Query + 1) * 2];
+
+		if (begin[1] && end[1])
+			AddSample(zone.Name, ToMilliseconds(begin[0], end[0], m_validBits), record);
+	}
+
+	frame.Zones.clear();
+}
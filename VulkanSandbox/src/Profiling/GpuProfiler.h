@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../Device/LogicalDevice.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct GpuZoneStats
+{
+	std::string Name;
+	double MinMs = 0.0;
+	double AvgMs = 0.0;
+	double MaxMs = 0.0;
+	uint32_t SampleCount = 0;
+};
+
+// GPU time of named zones, measured with timestamp queries. Every frame in flight has its own query
+// pool, which is read back in BeginFrame() once the frame's fence has been waited on, so reading never
+// stalls. Stats are rolling over the last VulkanConfig::GpuProfilerHistory samples of each zone.
+//
+// BeginFrame(), BeginZone() and EndZone() belong to the render thread and take the frame's primary
+// command buffer. Zones can't be written inside a render pass that executes secondary command buffers.
+class GpuProfiler
+{
+public:
+	GpuProfiler(const std::shared_ptr<LogicalDevice>& device);
+
+	void Destroy();
+
+	// First thing in the frame's command buffer, outside of a render pass. The frame number decides whether the
+	// frame's samples are recorded once they are read back.
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+
+	// Names have to outlive the profiler, string literals are fine. Returns UINT32_MAX once the frame is out of queries.
+	uint32_t BeginZone(VkCommandBuffer commandBuffer, const char* name);
+	void EndZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+	// For GPU time measured with queries of its own, like upload batches on the transfer queue. Any thread.
+	void AddSample(const char* name, double ms);
+
+	// Ticks of a timestamp query to milliseconds, validBits of the queue family that wrote them
+	double ToMilliseconds(uint64_t begin, uint64_t end, uint32_t validBits) const;
+
+	bool IsSupported() const { return m_validBits != 0; }
+
+	// Any thread
+	std::vector<GpuZoneStats> GetStats();
+
+	// Keeps every sample of frames from firstFrame on instead of only the rolling window, for benchmarks.
+	// Samples of earlier frames that are read back later are left out.
+	void BeginRecording(uint64_t firstFrame);
+	// The device has to be idle, the frames still waiting to be read back are read here
+	std::unordered_map<std::string, std::vector<double>> EndRecording();
+
+private:
+	struct Zone
+	{
+		const char* Name;
+		uint32_t Query; // Begin, end is the one after it
+	};
+
+	struct Frame
+	{
+		VkQueryPool QueryPool = VK_NULL_HANDLE;
+		std::vector<Zone> Zones;
+		uint64_t FrameNumber = 0; // Of the frame recorded into it
+	};
+
+	struct History
+	{
+		std::vector<double> Samples; // Ring
+		uint32_t Next = 0;
+	};
+
+	void ReadResults(Frame& frame);
+	void AddSample(const char* name, double ms, bool record);
+
+private:
+	std::shared_ptr<LogicalDevice> m_logicalDevice;
+
+	std::vector<Frame> m_frames; // Per frame in flight
+	uint32_t m_frameIndex = 0;
+
+	uint32_t m_validBits = 0;
+	double m_timestampPeriod = 1.0; // Nanoseconds per tick
+
+	std::vector<uint64_t> m_results;
+
+	std::unordered_map<std::string, History> m_history;
+	std::vector<std::string> m_order; // Zones in the order they first showed up
+	bool m_recording = false;
+	uint64_t m_recordingFirstFrame = 0;
+	std::unordered_map<std::string, std::vector<double>> m_recordedSamples;
+	std::mutex m_mutex;
+};
+
+// Times the commands recorded while it's alive
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+		: m_profiler(profiler), m_commandBuffer(commandBuffer), m_zone(profiler.BeginZone(commandBuffer, name))
+	{
+	}
+
+	~GpuProfileScope()
+	{
+		m_profiler.EndZone(m_commandBuffer, m_zone);
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler& m_profiler;
+	VkCommandBuffer m_commandBuffer;
+	uint32_t m_zone;
+};
\ No newline at end of file
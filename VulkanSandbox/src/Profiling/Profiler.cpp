@@ -0,0 +1,207 @@
+#include "Profiler.h"
+
+#ifndef VRELEASE
+
+#include "../Vulkan.h"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+struct ProfileEvent
+{
+	const char* Name;
+	int64_t Start; // Nanoseconds since the capture began
+	int64_t Duration;
+};
+
+// Written by its thread only. Events are published through Count, the reader takes [0, Count).
+struct ThreadBuffer
+{
+	std::vector<ProfileEvent> Events;
+	std::atomic<uint32_t> Count{ 0 };
+	std::atomic<uint32_t> Generation{ 0 }; // Capture the events belong to
+	std::atomic<uint32_t> Dropped{ 0 };
+
+	uint32_t ThreadId = 0;
+	std::string Name; // Guarded by ProfilerData::Mutex
+};
+
+struct ProfilerData
+{
+	std::mutex Mutex; // Registration and thread names
+	std::vector<std::unique_ptr<ThreadBuffer>> Buffers; // Kept when their thread exits, a capture may still read them
+
+	std::atomic<bool> Capturing{ false };
+	std::atomic<uint32_t> Generation{ 0 };
+	Profiler::Clock::time_point CaptureStart;
+
+	uint32_t FramesLeft = 0;
+	std::filesystem::path FramesFilepath;
+};
+
+static ProfilerData& GetData()
+{
+	static ProfilerData data;
+	return data;
+}
+
+static thread_local ThreadBuffer* t_buffer = nullptr;
+
+static ThreadBuffer& GetThreadBuffer()
+{
+	if (t_buffer)
+		return *t_buffer;
+
+	auto& data = GetData();
+	std::lock_guard<std::mutex> lock(data.Mutex);
+
+	auto buffer = std::make_unique<ThreadBuffer>();
+	buffer->Events.resize(VulkanConfig::ProfilerEventsPerThread);
+	buffer->ThreadId = (uint32_t)data.Buffers.size();
+
+	t_buffer = buffer.get();
+	data.Buffers.push_back(std::move(buffer));
+
+	return *t_buffer;
+}
+
+void Profiler::RecordEvent(const char* name, Clock::time_point start, Clock::time_point end)
+{
+	auto& data = GetData();
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	// First event of this thread in a new capture, throw out the old ones
+	uint32_t generation = data.Generation.load(std::memory_order_acquire);
+	if (buffer.Generation.load(std::memory_order_relaxed) != generation)
+	{
+		buffer.Count.store(0, std::memory_order_relaxed);
+		buffer.Dropped.store(0, std::memory_order_relaxed);
+		buffer.Generation.store(generation, std::memory_order_release);
+	}
+
+	uint32_t index = buffer.Count.load(std::memory_order_relaxed);
+	if (index >= buffer.Events.size())
+	{
+		buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ProfileEvent& event = buffer.Events[index];
+	event.Name = name;
+	event.Start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - data.CaptureStart).count();
+	event.Duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+	buffer.Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(GetData().Mutex);
+	buffer.Name = name;
+}
+
+void Profiler::BeginCapture()
+{
+	auto& data = GetData();
+	if (data.Capturing)
+		return;
+
+	data.CaptureStart = Clock::now();
+	data.Generation.fetch_add(1, std::memory_order_release);
+	data.Capturing.store(true, std::memory_order_release);
+
+	LOG("Profiler capture started");
+}
+
+void Profiler::EndCapture(const std::filesystem::path& filepath)
+{
+	auto& data = GetData();
+	if (!data.Capturing)
+		return;
+
+	// Scopes that are still open finish behind the counts read below, so they are left out
+	data.Capturing.store(false, std::memory_order_release);
+	data.FramesLeft = 0;
+
+	uint32_t generation = data.Generation.load(std::memory_order_relaxed);
+
+	std::ofstream file(filepath);
+	if (!file)
+	{
+		LOG("Failed to open " << filepath << " for writing!");
+		return;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[";
+
+	size_t eventCount = 0;
+	uint32_t droppedCount = 0;
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(data.Mutex);
+
+	for (const auto& buffer : data.Buffers)
+	{
+		if (buffer->Generation.load(std::memory_order_acquire) != generation)
+			continue;
+
+		uint32_t count = buffer->Count.load(std::memory_order_acquire);
+		droppedCount += buffer->Dropped.load(std::memory_order_relaxed);
+
+		std::string threadName = buffer->Name.empty() ? "Thread " + std::to_string(buffer->ThreadId) : buffer->Name;
+		file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+		first = false;
+
+		// Chrome wants microseconds
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const ProfileEvent& event = buffer->Events[i];
+			file << ",\n{\"name\":\"" << event.Name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->ThreadId;
+			file << ",\"ts\":" << event.Start / 1000.0 << ",\"dur\":" << event.Duration / 1000.0 << "}";
+		}
+
+		eventCount += count;
+	}
+
+	file << "\n]}\n";
+
+	std::stringstream ss;
+	ss << "Profiler capture written to " << filepath << ", " << eventCount << " events";
+	if (droppedCount)
+		ss << ", " << droppedCount << " dropped";
+	LOG(ss.str());
+}
+
+void Profiler::CaptureFrames(uint32_t frameCount, const std::filesystem::path& filepath)
+{
+	auto& data = GetData();
+	if (data.Capturing || frameCount == 0)
+		return;
+
+	BeginCapture();
+
+	data.FramesLeft = frameCount;
+	data.FramesFilepath = filepath;
+}
+
+bool Profiler::IsCapturing()
+{
+	return GetData().Capturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::MarkFrame()
+{
+	auto& data = GetData();
+	if (data.FramesLeft == 0)
+		return;
+
+	if (--data.FramesLeft == 0)
+		EndCapture(data.FramesFilepath);
+}
+
+#endif
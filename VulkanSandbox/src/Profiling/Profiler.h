@@ -0,0 +1,73 @@
+#pragma once
+
+// CPU profiling, compiled out completely in Release
+#ifndef VRELEASE
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// Records scopes of every thread into per thread buffers while a capture runs and writes them out
+// as Chrome trace JSON (chrome://tracing, Perfetto). Only the owning thread writes to a buffer and
+// publishes events with an atomic count, so recording takes no locks. Outside of a capture a scope
+// costs one atomic load.
+class Profiler
+{
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Names have to outlive the capture, string literals are fine
+	static void RecordEvent(const char* name, Clock::time_point start, Clock::time_point end);
+
+	static void SetThreadName(const char* name);
+
+	// Capture control belongs to the main thread. EndCapture() writes everything recorded since BeginCapture().
+	static void BeginCapture();
+	static void EndCapture(const std::filesystem::path& filepath);
+	// Captures the next frameCount frames and writes them once the last one is marked
+	static void CaptureFrames(uint32_t frameCount, const std::filesystem::path& filepath);
+	static bool IsCapturing();
+
+	// Main thread, once per frame
+	static void MarkFrame();
+};
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+		: m_name(name), m_active(Profiler::IsCapturing())
+	{
+		if (m_active)
+			m_start = Profiler::Clock::now();
+	}
+
+	~ProfileScope()
+	{
+		if (m_active)
+			Profiler::RecordEvent(m_name, m_start, Profiler::Clock::now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	bool m_active;
+	Profiler::Clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#define PROFILE_FRAME() Profiler::MarkFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#define PROFILE_FRAME()
+
+#endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "RenderThread.h"
+
+#include "Profiling/Profiler.h"
+
+#include <chrono>
+
+RenderThread::RenderThread(RenderFn renderFn, uint32_t maxQueuedFrames)
+	: m_renderFn(renderFn)
+{
+	// One being drawn, the rest queued or being filled
+	m_snapshots.resize(maxQueuedFrames + 1);
+	for (uint32_t i = 0; i < (uint32_t)m_snapshots.size(); i++)
+		m_freeSnapshots.push_back(i);
+
+	m_thread = std::thread(&RenderThread::Loop, this);
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+FrameSnapshot& RenderThread::BeginSnapshot(double& blockedMs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_snapshotFreed.wait(lock, [&]() { return !m_freeSnapshots.empty(); });
+
+	m_fillingSnapshot = m_freeSnapshots.back();
+	m_freeSnapshots.pop_back();
+
+	blockedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return m_snapshots[m_fillingSnapshot];
+}
+
+void RenderThread::Submit()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queuedSnapshots.push_back(m_fillingSnapshot);
+	}
+
+	m_snapshotQueued.notify_one();
+}
+
+void RenderThread::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+
+	m_snapshotQueued.notify_one();
+
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void RenderThread::Loop()
+{
+	PROFILE_THREAD("Render");
+
+	while (true)
+	{
+		uint32_t snapshotIndex;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_snapshotQueued.wait(lock, [&]() { return !m_running || !m_queuedSnapshots.empty(); });
+
+			if (!m_running)
+				return;
+
+			snapshotIndex = m_queuedSnapshots.front();
+			m_queuedSnapshots.pop_front();
+		}
+
+		m_renderFn(m_snapshots[snapshotIndex]);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_freeSnapshots.push_back(snapshotIndex);
+		}
+
+		m_snapshotFreed.notify_one();
+	}
+}
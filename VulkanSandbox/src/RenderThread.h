@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Buffer/GeometryPool.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct RenderObject
+{
+	Mesh Geometry;
+	glm::mat4 Transform;
+	uint32_t TextureIndex = 0;
+};
+
+// Everything the render thread needs to draw a frame, produced by the simulation
+struct FrameSnapshot
+{
+	uint64_t FrameNumber = 0;
+	std::chrono::high_resolution_clock::time_point InputTime; // When the input this frame reacts to was polled
+	glm::mat4 View;
+	std::vector<RenderObject> Objects;
+};
+
+// Runs rendering on its own thread, fed with frame snapshots through a bounded queue. The main
+// thread fills the snapshot of frame N + 1 while the render thread draws frame N, and blocks in
+// BeginSnapshot() once it is maxQueuedFrames ahead. Snapshots are recycled, so their vectors keep
+// their capacity.
+class RenderThread
+{
+public:
+	using RenderFn = std::function<void(const FrameSnapshot& snapshot)>;
+
+	RenderThread(RenderFn renderFn, uint32_t maxQueuedFrames = VulkanConfig::MaxQueuedFrames);
+	~RenderThread();
+
+	// Blocks while the render thread is too far behind, returns the time spent waiting in milliseconds
+	FrameSnapshot& BeginSnapshot(double& blockedMs);
+	void Submit();
+
+	// Finishes the frame being drawn and joins, queued snapshots are dropped
+	void Stop();
+
+private:
+	void Loop();
+
+private:
+	RenderFn m_renderFn;
+	std::thread m_thread;
+
+	std::vector<FrameSnapshot> m_snapshots;
+	std::vector<uint32_t> m_freeSnapshots;
+	std::deque<uint32_t> m_queuedSnapshots;
+	uint32_t m_fillingSnapshot = 0;
+
+	bool m_running = true;
+
+	std::mutex m_mutex;
+	std::condition_variable m_snapshotQueued;
+	std::condition_variable m_snapshotFreed;
+};
\ No newline at end of file
@@ -1,10 +1,40 @@
 #include "Image.h"
 
+#include "Ktx2.h"
 #include "../Application.h"
+#include "../Memory/DeletionCommandQueue.h"
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+// The GPU filters _SRGB formats on linear values, averaging the encoded bytes instead darkens every level
+static float SrgbToLinear(uint8_t value)
+{
+	static const std::array<float, 256> s_table = []()
+	{
+		std::array<float, 256> table;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		return table;
+	}();
+
+	return s_table[value];
+}
+
+static uint8_t LinearToSrgb(float value)
+{
+	float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	return (uint8_t)std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f);
+}
+
 Image::Image(uint32_t width, uint32_t height)
 	: m_width(width), m_height(height)
 {
@@ -12,35 +42,74 @@ Image::Image(uint32_t width, uint32_t height)
 }
 
 Image::Image(const std::filesystem::path& filepath)
+	: Image(Decode(filepath))
 {
-	// Read pixels
-	int width, height, channels;
-	stbi_uc* data = nullptr;
-	
-	data = stbi_load(filepath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
-	m_width = width;
-	m_height = height;
-	VkDeviceSize size = m_width * m_height * 4;
-
-	if (!data)
-		throw std::runtime_error("Failed to load texture!");
 
-	// Staging buffer
-	VkBufferCreateInfo stagingBufferInfo{};
-	stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	stagingBufferInfo.size = size;
-	stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	stagingBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+}
+
+Image::Image(const ImageData& data)
+	: m_width(data.Width), m_height(data.Height)
+{
+	PROFILE_SCOPE("Image::Upload");
+
+	const VkFormat format = data.Format;
+
+	auto& device = Application::Get().GetDevice();
+	auto& uploadContext = Application::Get().GetUploadContext();
+
+	if (!Application::Get().GetPhysicalDevice()->SupportsSampledImage(format))
+		throw std::runtime_error("Image format is not supported by the device!");
+
+	// Block compressed images can't be blitted or filtered here, they bring their own levels
+	bool generateMips = VulkanConfig::GenerateMipmaps && data.MipLevels == 1 && data.Format == VK_FORMAT_R8G8B8A8_SRGB;
 
-	VkBuffer stagingBuffer;
-	VmaAllocation stagingBufferAlloc = Allocator::AllocateBuffer(stagingBuffer, stagingBufferInfo, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	if (generateMips)
+		m_mipLevels = CalculateMipLevels(m_width, m_height);
+	else
+		m_mipLevels = VulkanConfig::GenerateMipmaps ? data.MipLevels : 1;
 
-	void* memData = Allocator::MapMemory(stagingBufferAlloc);
-	memcpy(memData, data, (size_t)size);
+	// Mips are blitted on the GPU, formats without linear blit support get them filtered on the CPU and uploaded
+	bool blitMips = generateMips && m_mipLevels > 1 && Application::Get().GetPhysicalDevice()->SupportsLinearBlit(format);
 
-	// Clean up
-	Allocator::UnmapMemory(stagingBufferAlloc);
-	stbi_image_free(data);
+	ImageData cpuMips;
+	if (generateMips && m_mipLevels > 1 && !blitMips)
+		cpuMips = GenerateMips(data);
+
+	const ImageData& source = cpuMips.Pixels.empty() ? data : cpuMips;
+
+	std::vector<VkBufferImageCopy> copyRegions;
+	VkDeviceSize size = 0;
+
+	for (uint32_t mip = 0; mip < (blitMips ? 1 : m_mipLevels); mip++)
+	{
+		uint32_t width = std::max(m_width >> mip, 1u);
+		uint32_t height = std::max(m_height >> mip, 1u);
+
+		VkBufferImageCopy copyRegion{};
+		copyRegion.bufferOffset = size;
+		copyRegion.bufferRowLength = 0;
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = mip;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = { 0, 0, 0 };
+		copyRegion.imageExtent = { width, height, 1 };
+		copyRegions.push_back(copyRegion);
+
+		size += GetLevelSize(format, width, height);
+	}
+
+	for (uint32_t mip = 0; mip < m_mipLevels; mip++)
+		m_memorySize += GetLevelSize(format, std::max(m_width >> mip, 1u), std::max(m_height >> mip, 1u));
+
+	if (size > source.Pixels.size())
+		throw std::runtime_error("Image data is smaller than its levels!");
+
+	StagingAllocation staging = Allocator::AllocateStaging(source.Pixels.data(), size);
+
+	for (auto& copyRegion : copyRegions)
+		copyRegion.bufferOffset += staging.Offset;
 
 	// Image
 	VkImageCreateInfo imageInfo{};
@@ -49,96 +118,276 @@ Image::Image(const std::filesystem::path& filepath)
 	imageInfo.extent.width = m_width;
 	imageInfo.extent.height = m_height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = m_mipLevels;
 	imageInfo.arrayLayers = 1;
-	imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+	imageInfo.format = format;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.flags = 0;
 
-	m_allocation = Allocator::AllocateImage(m_image, imageInfo, VMA_MEMORY_USAGE_GPU_ONLY);
+	m_allocation = Allocator::AllocateImage(m_image, imageInfo, AllocationCategory::Image, VMA_MEMORY_USAGE_GPU_ONLY);
 
-	auto& device = Application::Get().GetDevice();
-	VkCommandBuffer commandBuffer = device->GetCommandBuffer(true);
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = m_mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
 
+	uploadContext->Record([&](VkCommandBuffer commandBuffer)
 	{
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = m_image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-	}
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = m_image;
+			barrier.subresourceRange = range;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-	VkBufferImageCopy copyRegion{};
-	copyRegion.bufferOffset = 0;
-	copyRegion.bufferRowLength = 0;
-	copyRegion.bufferImageHeight = 0;
-	copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	copyRegion.imageSubresource.mipLevel = 0;
-	copyRegion.imageSubresource.baseArrayLayer = 0;
-	copyRegion.imageSubresource.layerCount = 1;
-	copyRegion.imageOffset = { 0, 0, 0 };
-	copyRegion.imageExtent = { m_width, m_height, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
 
-	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+		vkCmdCopyBufferToImage(commandBuffer, staging.Buffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copyRegions.size(), copyRegions.data());
+	});
 
+	if (blitMips)
 	{
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = m_image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		// Blits need the graphics queue, the image stays in transfer dst until the chain is built
+		uploadContext->ReleaseImageToGraphics(m_image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		m_uploadTicket = uploadContext->RecordGraphics([&](VkCommandBuffer commandBuffer) { RecordMipBlits(commandBuffer); });
+	} else
+	{
+		m_uploadTicket = uploadContext->ReleaseImageToGraphics(m_image, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 	}
 
-	device->FlushCommandBuffer(commandBuffer);
+	uploadContext->ReleaseOnComplete(staging);
 
 	// Image view
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = m_image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
+	viewInfo.format = format;
+	viewInfo.subresourceRange = range;
 
 	VK_CHECK(vkCreateImageView(device->GetNativeDevice(), &viewInfo, nullptr, &m_imageView), "Failed to create image view!");
 
-	// Clean up
-	Allocator::DestroyBuffer(stagingBuffer, stagingBufferAlloc);
+	Allocator::RegisterMovable(m_allocation, &m_image, &m_imageView, imageInfo, viewInfo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+ImageData Image::Decode(const std::filesystem::path& filepath)
+{
+	PROFILE_SCOPE("Image::Decode");
+
+	if (filepath.extension() == ".ktx2")
+		return Ktx2::Load(filepath);
+
+	// Read pixels
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load(filepath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+	if (!pixels)
+		throw std::runtime_error("Failed to load texture!");
+
+	ImageData data;
+	data.Width = width;
+	data.Height = height;
+	data.Pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	stbi_image_free(pixels);
+
+	return data;
+}
+
+uint32_t Image::CalculateMipLevels(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+
+	while ((width | height) >> levels)
+		levels++;
+
+	return levels;
+}
+
+ImageData Image::GenerateMips(const ImageData& data)
+{
+	PROFILE_SCOPE("Image::GenerateMips");
+
+	ImageData mips;
+	mips.Width = data.Width;
+	mips.Height = data.Height;
+	mips.Format = data.Format;
+	mips.MipLevels = CalculateMipLevels(data.Width, data.Height);
+
+	VkDeviceSize size = 0;
+	for (uint32_t mip = 0; mip < mips.MipLevels; mip++)
+		size += GetLevelSize(mips.Format, std::max(data.Width >> mip, 1u), std::max(data.Height >> mip, 1u));
+
+	mips.Pixels.resize((size_t)size);
+	memcpy(mips.Pixels.data(), data.Pixels.data(), (size_t)data.Width * data.Height * 4);
+
+	bool srgb = data.Format == VK_FORMAT_R8G8B8A8_SRGB;
+
+	const uint8_t* src = mips.Pixels.data();
+	uint8_t* dst = mips.Pixels.data() + (size_t)data.Width * data.Height * 4;
+	uint32_t srcWidth = data.Width;
+	uint32_t srcHeight = data.Height;
+
+	for (uint32_t mip = 1; mip < mips.MipLevels; mip++)
+	{
+		uint32_t width = std::max(srcWidth / 2, 1u);
+		uint32_t height = std::max(srcHeight / 2, 1u);
+
+		// 2x2 box filter, the last row or column of odd sized levels is clamped
+		for (uint32_t y = 0; y < height; y++)
+		{
+			uint32_t y0 = std::min(y * 2, srcHeight - 1);
+			uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint32_t x0 = std::min(x * 2, srcWidth - 1);
+				uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+				const uint8_t* texels[4] = { &src[((size_t)y0 * srcWidth + x0) * 4], &src[((size_t)y0 * srcWidth + x1) * 4],
+					&src[((size_t)y1 * srcWidth + x0) * 4], &src[((size_t)y1 * srcWidth + x1) * 4] };
+
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					// Alpha is stored linear in _SRGB formats too
+					if (srgb && c < 3)
+					{
+						float sum = SrgbToLinear(texels[0][c]) + SrgbToLinear(texels[1][c]) + SrgbToLinear(texels[2][c]) + SrgbToLinear(texels[3][c]);
+						dst[((size_t)y * width + x) * 4 + c] = LinearToSrgb(sum * 0.25f);
+					} else
+					{
+						uint32_t sum = texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c];
+						dst[((size_t)y * width + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+
+		src = dst;
+		dst += (size_t)width * height * 4;
+		srcWidth = width;
+		srcHeight = height;
+	}
+
+	return mips;
+}
+
+VkDeviceSize Image::GetLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+	uint32_t blockSize;
+	uint32_t blockBytes;
+
+	switch (format)
+	{
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			blockSize = 1; blockBytes = 4; break;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			blockSize = 4; blockBytes = 8; break;
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+		case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+			blockSize = 4; blockBytes = 16; break;
+		default:
+			return 0;
+	}
+
+	VkDeviceSize blocksX = (width + blockSize - 1) / blockSize;
+	VkDeviceSize blocksY = (height + blockSize - 1) / blockSize;
+
+	return blocksX * blocksY * blockBytes;
+}
+
+void Image::RecordMipBlits(VkCommandBuffer commandBuffer)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	int32_t width = (int32_t)m_width;
+	int32_t height = (int32_t)m_height;
+
+	// Every level is filtered from the one above it, which is done with once it has been read
+	for (uint32_t mip = 1; mip < m_mipLevels; mip++)
+	{
+		barrier.subresourceRange.baseMipLevel = mip - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		int32_t mipWidth = std::max(width / 2, 1);
+		int32_t mipHeight = std::max(height / 2, 1);
+
+		VkImageBlit blit{};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { width, height, 1 };
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = mip - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = mip;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+
+		vkCmdBlitImage(commandBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		width = mipWidth;
+		height = mipHeight;
+	}
+
+	// The last level was only written to
+	barrier.subresourceRange.baseMipLevel = m_mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 Image::~Image()
 {
-	VkDevice device = Application::Get().GetDevice()->GetNativeDevice();
+	// Can't pull the image out from under a copy that is still in flight
+	Application::Get().GetUploadContext()->Wait(m_uploadTicket);
 
-	vkDestroyImageView(device, m_imageView, nullptr);
-	Allocator::DestroyImage(m_image, m_allocation);
+	// Frames in flight may still be sampling it
+	Allocator::UnregisterMovable(m_allocation);
+	DeletionCommandQueue::DestroyImageView(m_imageView);
+	DeletionCommandQueue::DestroyImage(m_image, m_allocation);
 }
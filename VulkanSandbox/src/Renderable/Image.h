@@ -1,26 +1,62 @@
 #pragma once
 
+#include "../Device/UploadContext.h"
 #include "../Memory/Allocator.h"
 
 #include <filesystem>
 
+// Pixels of level 0 followed by the smaller levels, tightly packed. Decoded JPEG/PNG files are RGBA8 with a
+// single level, KTX2 files come with their own format and levels.
+struct ImageData
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+	uint32_t MipLevels = 1;
+	std::vector<uint8_t> Pixels;
+};
+
 class Image
 {
 public:
 	Image(uint32_t width, uint32_t height);
 	Image(const std::filesystem::path& filepath);
+	Image(const ImageData& data);
 	~Image();
 
+	// Touches no Vulkan state, so it can run on a job while the device is busy with something else. KTX2
+	// files are read as they are, anything else goes through stb_image.
+	static ImageData Decode(const std::filesystem::path& filepath);
+
+	// Full chain down to 1x1
+	static uint32_t CalculateMipLevels(uint32_t width, uint32_t height);
+	// Full chain of an RGBA8 image with a box filter, for formats the GPU can't blit
+	static ImageData GenerateMips(const ImageData& data);
+	// Bytes of a level, 0 for formats we can't upload
+	static VkDeviceSize GetLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
 	VkImageView GetImageView() { return m_imageView; }
 
 	uint32_t GetWidth() const { return m_width; }
 	uint32_t GetHeight() const { return m_height; }
+	uint32_t GetMipLevels() const { return m_mipLevels; }
+	VkDeviceSize GetMemorySize() const { return m_memorySize; }
+
+	UploadTicket GetUploadTicket() const { return m_uploadTicket; }
+
+private:
+	// Fills levels 1 and up from level 0 on the graphics queue, every level ends up shader readable
+	void RecordMipBlits(VkCommandBuffer commandBuffer);
 
 private:
 	uint32_t m_width;
 	uint32_t m_height;
+	uint32_t m_mipLevels = 1;
+	VkDeviceSize m_memorySize = 0; // Of all levels, without alignment and padding
 
 	VkImage m_image;
 	VkImageView m_imageView;
 	VmaAllocation m_allocation;
+
+	UploadTicket m_uploadTicket = 0;
 };
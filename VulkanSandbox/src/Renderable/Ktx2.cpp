@@ -0,0 +1,113 @@
+#include "Ktx2.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const uint8_t s_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct Ktx2Header
+{
+	uint8_t Identifier[12];
+	uint32_t Format;
+	uint32_t TypeSize;
+	uint32_t PixelWidth;
+	uint32_t PixelHeight;
+	uint32_t PixelDepth;
+	uint32_t LayerCount;
+	uint32_t FaceCount;
+	uint32_t LevelCount;
+	uint32_t SupercompressionScheme;
+
+	uint32_t DfdByteOffset;
+	uint32_t DfdByteLength;
+	uint32_t KvdByteOffset;
+	uint32_t KvdByteLength;
+	uint64_t SgdByteOffset;
+	uint64_t SgdByteLength;
+};
+
+struct Ktx2Level
+{
+	uint64_t ByteOffset;
+	uint64_t ByteLength;
+	uint64_t UncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header has to match the file layout");
+
+static bool ReadHeader(std::ifstream& stream, Ktx2Header& header)
+{
+	stream.read((char*)&header, sizeof(header));
+
+	return stream && memcmp(header.Identifier, s_identifier, sizeof(s_identifier)) == 0;
+}
+
+ImageData Ktx2::Load(const std::filesystem::path& filepath)
+{
+	std::ifstream stream(filepath, std::ios::binary);
+
+	Ktx2Header header;
+	if (!stream || !ReadHeader(stream, header))
+		throw std::runtime_error("Failed to load KTX2 texture!");
+
+	if (header.PixelDepth > 1 || header.LayerCount > 1 || header.FaceCount != 1 || header.SupercompressionScheme != 0)
+		throw std::runtime_error("KTX2 texture has to be a single 2D image without supercompression!");
+
+	// Checked before anything is sized from the header
+	if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.LevelCount > Image::CalculateMipLevels(header.PixelWidth, header.PixelHeight))
+		throw std::runtime_error("KTX2 texture has an invalid size or level count!");
+
+	ImageData data;
+	data.Width = header.PixelWidth;
+	data.Height = header.PixelHeight;
+	data.Format = (VkFormat)header.Format;
+	data.MipLevels = std::max(header.LevelCount, 1u); // 0 asks the loader to generate them, there is only level 0
+
+	if (Image::GetLevelSize(data.Format, 1, 1) == 0)
+		throw std::runtime_error("KTX2 texture format is not supported!");
+
+	std::vector<Ktx2Level> levels(data.MipLevels);
+	stream.read((char*)levels.data(), levels.size() * sizeof(Ktx2Level));
+
+	if (!stream)
+		throw std::runtime_error("Failed to load KTX2 texture!");
+
+	VkDeviceSize size = 0;
+	for (uint32_t mip = 0; mip < data.MipLevels; mip++)
+	{
+		VkDeviceSize levelSize = Image::GetLevelSize(data.Format, std::max(data.Width >> mip, 1u), std::max(data.Height >> mip, 1u));
+
+		if (levels[mip].ByteLength != levelSize)
+			throw std::runtime_error("KTX2 texture level has the wrong size!");
+
+		size += levelSize;
+	}
+
+	// The level index lists level 0 first, as Image wants it, whatever order the data has in the file
+	data.Pixels.resize((size_t)size);
+
+	size_t offset = 0;
+	for (const auto& level : levels)
+	{
+		stream.seekg(level.ByteOffset);
+		stream.read((char*)data.Pixels.data() + offset, level.ByteLength);
+		offset += (size_t)level.ByteLength;
+	}
+
+	if (!stream)
+		throw std::runtime_error("Failed to load KTX2 texture!");
+
+	return data;
+}
+
+VkFormat Ktx2::GetFormat(const std::filesystem::path& filepath)
+{
+	std::ifstream stream(filepath, std::ios::binary);
+
+	Ktx2Header header;
+	if (!stream || !ReadHeader(stream, header))
+		return VK_FORMAT_UNDEFINED;
+
+	return (VkFormat)header.Format;
+}
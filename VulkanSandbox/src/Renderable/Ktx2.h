@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Image.h"
+
+// Reader for KTX2 containers (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) as written by
+// the TextureConverter. Only single layer 2D textures without supercompression, in a format Image can upload.
+class Ktx2
+{
+public:
+	static ImageData Load(const std::filesystem::path& filepath);
+
+	// Reads just the header, 0 when the file is missing or no KTX2 file
+	static VkFormat GetFormat(const std::filesystem::path& filepath);
+};
\ No newline at end of file
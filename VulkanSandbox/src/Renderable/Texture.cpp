@@ -0,0 +1,89 @@
+#include "Texture.h"
+
+#include "Ktx2.h"
+#include "../Application.h"
+#include "../Profiling/Profiler.h"
+
+#include <array>
+
+// Written by the TextureConverter, best quality first
+static const std::array<const char*, 3> s_compressedVariants = { ".bc7.ktx2", ".astc.ktx2", ".bc1.ktx2" };
+
+Texture::Texture(const std::filesystem::path& filepath, const std::shared_ptr<Image>& placeholder)
+	: m_filepath(filepath), m_placeholder(placeholder)
+{
+	JobSystem::RunBackground([this]()
+	{
+		PROFILE_SCOPE("Texture::Load");
+
+		// A texture that fails to load keeps showing the placeholder instead of taking the application down
+		try
+		{
+			m_image = std::make_shared<Image>(Image::Decode(m_filepath));
+			m_loaded.store(true, std::memory_order_release);
+		} catch (const std::exception& e)
+		{
+			LOG("Failed to load texture " << m_filepath << ": " << e.what());
+		}
+	}, &m_loading);
+}
+
+Texture::~Texture()
+{
+	// The load job writes into this texture
+	JobSystem::Wait(m_loading);
+}
+
+VkImageView Texture::GetImageView()
+{
+	return IsResident() ? m_image->GetImageView() : m_placeholder->GetImageView();
+}
+
+bool Texture::IsResident()
+{
+	if (m_resident)
+		return true;
+
+	if (!m_loaded.load(std::memory_order_acquire))
+		return false;
+
+	m_resident = Application::Get().GetUploadContext()->IsComplete(m_image->GetUploadTicket());
+
+	return m_resident;
+}
+
+void Texture::WaitUntilResident()
+{
+	JobSystem::Wait(m_loading);
+
+	if (m_loaded.load(std::memory_order_acquire))
+	{
+		Application::Get().GetUploadContext()->Wait(m_image->GetUploadTicket());
+		m_resident = true;
+	}
+}
+
+VkDeviceSize Texture::GetMemorySize()
+{
+	return IsResident() ? m_image->GetMemorySize() : 0;
+}
+
+std::filesystem::path Texture::FindCompressedVariant(const std::filesystem::path& filepath)
+{
+	if (filepath.extension() == ".ktx2")
+		return filepath;
+
+	auto& physicalDevice = Application::Get().GetPhysicalDevice();
+
+	for (const char* variant : s_compressedVariants)
+	{
+		std::filesystem::path candidate = filepath;
+		candidate.replace_extension(variant);
+
+		VkFormat format = Ktx2::GetFormat(candidate);
+		if (format != VK_FORMAT_UNDEFINED && physicalDevice->SupportsSampledImage(format))
+			return candidate;
+	}
+
+	return filepath;
+}
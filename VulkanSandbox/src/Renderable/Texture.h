@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Image.h"
+#include "../Assets/Asset.h"
+#include "../Jobs/JobSystem.h"
+
+#include <atomic>
+
+// Image that is decoded and uploaded on the job system, so loading many of them scales with the
+// worker count. It can be bound right away: until the upload has completed on the GPU it hands out
+// the placeholder, callers that cache the view compare it every frame to pick up the swap.
+class Texture : public Asset
+{
+public:
+	Texture(const std::filesystem::path& filepath, const std::shared_ptr<Image>& placeholder);
+	~Texture();
+
+	// Render thread
+	VkImageView GetImageView();
+	bool IsResident();
+	// Blocks until the load job and the upload have finished, textures that failed to load keep the placeholder.
+	// Not while the render thread is drawing.
+	void WaitUntilResident();
+	VkDeviceSize GetMemorySize() override;
+
+	// Loaded as it is, callers go through FindCompressedVariant first
+	const std::filesystem::path& GetFilepath() const { return m_filepath; }
+
+	// Looks for <name>.bc7.ktx2, <name>.astc.ktx2 and <name>.bc1.ktx2 next to the file, in that order
+	static std::filesystem::path FindCompressedVariant(const std::filesystem::path& filepath);
+
+private:
+	std::filesystem::path m_filepath;
+	std::shared_ptr<Image> m_placeholder;
+
+	std::shared_ptr<Image> m_image; // Written by the load job, only read once m_loaded is set
+	std::atomic<bool> m_loaded{ false };
+	bool m_resident = false;
+
+	JobCounter m_loading;
+};
\ No newline at end of file
@@ -18,9 +18,31 @@ struct VulkanConfig
 	inline static const uint32_t Height = 600;
 
 	inline static const bool EnableValidation = true;
-	inline static const uint32_t MaxFramesInFlight = 2;
+	inline static uint32_t MaxFramesInFlight = 2; // Set from ApplicationSpecification, fixed once the Application exists
+	inline static const uint32_t MaxFramesInFlightLimit = 4;
+	inline static bool GenerateMipmaps = true; // Set from ApplicationSpecification, fixed once the Application exists
+	inline static const VkDeviceSize StagingBufferSize = 32 * 1024 * 1024;
+	inline static const uint32_t UniformBufferSizePerFrame = 4 * 1024 * 1024; // At least, scenes with more objects get more
+	inline static const uint32_t GeometryPoolVertexCount = 1024 * 1024;
+	inline static const uint32_t GeometryPoolIndexCount = 4 * 1024 * 1024;
+	inline static const uint32_t RenderCommandQueueSize = 10 * 1024 * 1024; // Per side
+	inline static const uint32_t JobThreadCount = 0; // All cores but the main one
+	inline static const uint32_t ParallelRecordingMinDraws = 2048;
+	inline static const uint32_t MinDrawsPerSlice = 256;
+	inline static const uint32_t MaxQueuedFrames = 1; // Snapshots the main thread may be ahead of the render thread
+	inline static const VkDeviceSize DefragmentationMaxBytesPerPass = 16 * 1024 * 1024;
+	inline static const uint32_t DefragmentationMaxMovesPerPass = 64;
+	inline static const VkDeviceSize DefragmentationMinUnusedBytes = 32 * 1024 * 1024;
+	inline static const uint32_t DefragmentationCheckInterval = 600; // Frames
+	inline static const uint32_t GpuProfilerMaxZones = 64; // Per frame
+	inline static const uint32_t GpuProfilerHistory = 120; // Samples per zone the stats are taken over
+	inline static const uint32_t ProfilerEventsPerThread = 64 * 1024; // Per capture, later events are dropped
+	inline static const VkDeviceSize AssetCacheBudget = 256 * 1024 * 1024; // Unreferenced assets are evicted above this
+	inline static const float BenchmarkTimestep = 1.0f / 60.0f; // Seconds of animation per benchmark frame
+	inline static const uint32_t BenchmarkWarmupFrames = 60; // Left out of the benchmark results
 	inline static const std::vector<const char*> ValidationLayers{ "VK_LAYER_KHRONOS_validation" };
 	inline static const std::vector<const char*> DeviceExtensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	inline static const std::vector<const char*> OptionalDeviceExtensions{ VK_EXT_MEMORY_BUDGET_EXTENSION_NAME };
 };
 
 static uint32_t FindMemoryType(VkPhysicalDevice device, uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -1,8 +1,86 @@
 #include "Application.h"
+#include "Benchmark/Benchmark.h"
 
-int main()
+#include <string>
+#include <string_view>
+
+int main(int argc, char** argv)
 {
-	Application app;
+	ApplicationSpecification specification;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+
+		if (arg == "--benchmark-render-queue")
+		{
+			RunRenderCommandQueueBenchmark();
+			return 0;
+		}
+
+		if (arg == "--benchmark-jobs")
+		{
+			RunJobSystemBenchmark();
+			return 0;
+		}
+
+		if (arg == "--no-render-thread")
+			specification.RenderThread = false;
+
+		if (arg == "--frames-in-flight" && i + 1 < argc)
+			specification.FramesInFlight = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--present-mode" && i + 1 < argc)
+		{
+			std::string_view mode = argv[++i];
+			if (mode == "fifo")
+				specification.PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+			else if (mode == "mailbox")
+				specification.PresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			else if (mode == "immediate")
+				specification.PresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			else
+				LOG("Unknown present mode " << mode << ", use fifo, mailbox or immediate");
+		}
+
+		if (arg == "--frame-limit" && i + 1 < argc)
+			specification.FrameLimit = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--headless")
+			specification.Headless = true;
+
+		if (arg == "--frames" && i + 1 < argc)
+			specification.FrameCount = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--readback" && i + 1 < argc)
+			specification.ReadbackPath = argv[++i];
+
+		if (arg == "--mesh" && i + 1 < argc)
+			specification.MeshPath = argv[++i];
+
+		if (arg == "--benchmark")
+			specification.Benchmark = true;
+
+		if (arg == "--benchmark-path" && i + 1 < argc)
+			specification.BenchmarkPath = argv[++i];
+
+		if (arg == "--objects" && i + 1 < argc)
+			specification.ObjectCount = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--textures" && i + 1 < argc)
+			specification.TextureCount = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--no-mipmaps")
+			specification.Mipmaps = false;
+
+		if (arg == "--trace-frames" && i + 1 < argc)
+			specification.TraceFrames = (uint32_t)std::stoul(argv[++i]);
+
+		if (arg == "--trace-path" && i + 1 < argc)
+			specification.TracePath = argv[++i];
+	}
+
+	Application app(specification);
 	app.Run();
 
 	return 0;
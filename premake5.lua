@@ -55,3 +55,62 @@ project "VulkanSandbox"
 		defines "VRELEASE"
 		runtime "Release"
 		optimize "On"
+
+project "TextureConverter"
+	location "TextureConverter"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "Off"
+
+	targetdir ("%{wks.location}/bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("%{wks.location}/bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files {
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp"
+	}
+
+	includedirs {
+		"%{IncludeDir.stb}",
+		"%{IncludeDir.VulkanSDK}"
+	}
+
+	filter "configurations:Debug"
+		defines "VDEBUG"
+		runtime "Debug"
+		symbols "On"
+
+	filter "configurations:Release"
+		defines "VRELEASE"
+		runtime "Release"
+		optimize "On"
+
+project "MeshImporter"
+	location "MeshImporter"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "Off"
+
+	targetdir ("%{wks.location}/bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("%{wks.location}/bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files {
+		"%{prj.name}/src/**.h",
+		"%{prj.name}/src/**.cpp"
+	}
+
+	includedirs {
+		"VulkanSandbox/src"
+	}
+
+	filter "configurations:Debug"
+		defines "VDEBUG"
+		runtime "Debug"
+		symbols "On"
+
+	filter "configurations:Release"
+		defines "VRELEASE"
+		runtime "Release"
+		optimize "On"